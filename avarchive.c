@@ -0,0 +1,762 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avarchive.c
+//  Description   : This file contains the compressed time series archive of
+//                  the avparse library, the readings of each station are
+//                  stored in time order in blocks, each field a column of
+//                  zigzag varint deltas (reports of a station change little
+//                  from one to the next, so most deltas take a single byte).
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Wed Dec 18 13:22:09 EST 2019
+*/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <avparse.h>
+#include <avpacked.h>
+#include <avarchive.h>
+
+/* Definitions */
+#define AVARCHIVE_HEADER_MAX 20 /* The most bytes a block header encodes to */
+
+/* Write a column of deltas of a record field */
+#define AVARCHIVE_PUT_DELTAS(p, blk, n, field) { \
+	int32_t prev = 0; \
+	for ( i = 0; i < (n); i ++ ) { \
+		p = put_avarchive_varint( p, AVARCHIVE_ZIGZAG((int32_t)(blk)[i].field - prev) ); \
+		prev = (blk)[i].field; \
+	} }
+
+/* Read a column of deltas into a record field (of type) */
+#define AVARCHIVE_GET_DELTAS(p, end, out, n, field, type) { \
+	uint32_t prev = 0, u; \
+	for ( i = 0; i < (n); i ++ ) { \
+		if ( get_avarchive_varint(&p, end, &u) != 0 ) { \
+			return( -1 ); \
+		} \
+		prev += (uint32_t)AVARCHIVE_UNZIGZAG(u); \
+		(out)[i].field = (type)prev; \
+	} }
+
+/* The sort key of a reading (station, time, then input order) */
+typedef struct avarchive_key_struct {
+	uint32_t  station;  /* The packed station code */
+	uint32_t  zulu;     /* The (zulu) time, minutes since the epoch */
+	uint32_t  pos;      /* The position the reading was added in */
+} avarchive_key;
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : put_avarchive_varint
+// Description  : encode a value as a varint (7 bits a byte, low bits first)
+//
+// Inputs       : p - the position to write to
+//                val - the value to encode
+// Outputs      : the position after the varint
+*/
+
+static uint8_t * put_avarchive_varint( uint8_t *p, uint32_t val ) {
+
+	/* Write the low 7 bits until the rest fits a byte */
+	while ( val >= 0x80 ) {
+		*p++ = (uint8_t)(val | 0x80);
+		val >>= 7;
+	}
+	*p++ = (uint8_t)val;
+	return( p );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : get_avarchive_varint
+// Description  : decode a varint
+//
+// Inputs       : pos - the position to read from (advanced past the varint)
+//                end - the end of the data
+//                val - the decoded value
+// Outputs      : 0 if successful, -1 if the varint is cut off or too long
+*/
+
+static inline int get_avarchive_varint( const uint8_t **pos, const uint8_t *end, uint32_t *val ) {
+
+	/* Local variables */
+	const uint8_t *p = *pos;
+	uint32_t v = 0;
+	int shift;
+
+	/* Most deltas fit a single byte, otherwise gather the bytes until one
+	   without the continuation bit */
+	if ( (p < end) && (*p < 0x80) ) {
+		*val = *p;
+		*pos = p + 1;
+		return( 0 );
+	}
+	for ( shift = 0; (shift < 35) && (p < end); shift += 7 ) {
+		v |= (uint32_t)(*p & 0x7f) << shift;
+		if ( (*p++ & 0x80) == 0 ) {
+			*val = v;
+			*pos = p;
+			return( 0 );
+		}
+	}
+	return( -1 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : compare_avarchive_keys
+// Description  : compare two reading sort keys (qsort callback)
+//
+// Inputs       : a, b - the keys to compare
+// Outputs      : -1, 0 or 1 as a sorts before, with or after b
+*/
+
+static int compare_avarchive_keys( const void *a, const void *b ) {
+
+	/* Local variables */
+	const avarchive_key *x = a, *y = b;
+
+	/* Order by station, then time, then the order added */
+	if ( x->station != y->station ) {
+		return( (x->station < y->station) ? -1 : 1 );
+	}
+	if ( x->zulu != y->zulu ) {
+		return( (x->zulu < y->zulu) ? -1 : 1 );
+	}
+	return( (x->pos < y->pos) ? -1 : (x->pos > y->pos) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : encode_avarchive_block
+// Description  : encode the payload of a block (the readings of one station
+//                in time order), one column per field
+//
+// Inputs       : blk - the readings of the block
+//                n - the number of readings (at most AVARCHIVE_BLOCK)
+//                buf - the buffer to encode to (n * AVARCHIVE_RECORD_MAX)
+// Outputs      : the length of the payload
+*/
+
+static size_t encode_avarchive_block( const avreading_packed *blk, unsigned int n, uint8_t *buf ) {
+
+	/* Local variables */
+	uint8_t *p = buf;
+	unsigned int i, g, no;
+	int32_t prev;
+
+	/* The times (in order, so deltas from the first are never negative) */
+	for ( i = 0; i < n; i ++ ) {
+		p = put_avarchive_varint( p, blk[i].zulu - blk[(i > 0) ? i-1 : 0].zulu );
+	}
+
+	/* The scalar fields */
+	AVARCHIVE_PUT_DELTAS( p, blk, n, gmtoff );
+	for ( i = 0; i < n; i ++ ) {
+		p = put_avarchive_varint( p, blk[i].flags | ((uint32_t)blk[i].missing << 8) );
+	}
+	AVARCHIVE_PUT_DELTAS( p, blk, n, wind_direction );
+	AVARCHIVE_PUT_DELTAS( p, blk, n, wind_speed );
+	AVARCHIVE_PUT_DELTAS( p, blk, n, wind_gust );
+	AVARCHIVE_PUT_DELTAS( p, blk, n, visibility );
+	AVARCHIVE_PUT_DELTAS( p, blk, n, temperature );
+	AVARCHIVE_PUT_DELTAS( p, blk, n, dewpoint );
+	AVARCHIVE_PUT_DELTAS( p, blk, n, altimeter );
+
+	/* The condition groups (counts, the sets, then the groups themselves) */
+	for ( i = 0; i < n; i ++ ) {
+		p = put_avarchive_varint( p, blk[i].no_conds );
+	}
+	for ( i = 0; i < n; i ++ ) {
+		p = put_avarchive_varint( p, blk[i].cond_set );
+	}
+	for ( i = 0; i < n; i ++ ) {
+		no = (blk[i].no_conds < AVR_PACKED_CONDS) ? blk[i].no_conds : AVR_PACKED_CONDS;
+		for ( g = 0; g < no; g ++ ) {
+			p = put_avarchive_varint( p, blk[i].conds[g] );
+		}
+	}
+
+	/* The cloud layers (counts, then each layer as a delta of the last) */
+	for ( i = 0; i < n; i ++ ) {
+		p = put_avarchive_varint( p, blk[i].no_layers );
+	}
+	for ( i = 0, prev = 0; i < n; i ++ ) {
+		no = (blk[i].no_layers < AVR_PACKED_LAYERS) ? blk[i].no_layers : AVR_PACKED_LAYERS;
+		for ( g = 0; g < no; g ++ ) {
+			p = put_avarchive_varint( p, AVARCHIVE_ZIGZAG((int32_t)blk[i].layers[g] - prev) );
+			prev = blk[i].layers[g];
+		}
+	}
+	return( p - buf );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : decode_avarchive_block
+// Description  : decode the payload of a block into packed readings
+//
+// Inputs       : p - the start of the payload
+//                end - the end of the payload
+//                code - the packed station code of the readings
+//                first - the time of the first reading
+//                n - the number of readings (at most AVARCHIVE_BLOCK)
+//                out - the readings decoded
+// Outputs      : 0 if successful, -1 if the payload is corrupt
+*/
+
+static int decode_avarchive_block( const uint8_t *p, const uint8_t *end, uint32_t code, uint32_t first,
+								   unsigned int n, avreading_packed *out ) {
+
+	/* Local variables */
+	unsigned int i, g;
+	uint32_t u, zulu = first, prev;
+
+	/* The times and the scalar fields */
+	memset( out, 0x0, n * sizeof(avreading_packed) );
+	for ( i = 0; i < n; i ++ ) {
+		if ( get_avarchive_varint(&p, end, &u) != 0 ) {
+			return( -1 );
+		}
+		zulu += u;
+		out[i].station = code;
+		out[i].zulu = zulu;
+	}
+	AVARCHIVE_GET_DELTAS( p, end, out, n, gmtoff, int16_t );
+	for ( i = 0; i < n; i ++ ) {
+		if ( (get_avarchive_varint(&p, end, &u) != 0) || (u > UINT16_MAX) ) {
+			return( -1 );
+		}
+		out[i].flags = (uint8_t)u;
+		out[i].missing = (uint8_t)(u >> 8);
+	}
+	AVARCHIVE_GET_DELTAS( p, end, out, n, wind_direction, uint16_t );
+	AVARCHIVE_GET_DELTAS( p, end, out, n, wind_speed, uint8_t );
+	AVARCHIVE_GET_DELTAS( p, end, out, n, wind_gust, int8_t );
+	AVARCHIVE_GET_DELTAS( p, end, out, n, visibility, uint8_t );
+	AVARCHIVE_GET_DELTAS( p, end, out, n, temperature, int8_t );
+	AVARCHIVE_GET_DELTAS( p, end, out, n, dewpoint, int8_t );
+	AVARCHIVE_GET_DELTAS( p, end, out, n, altimeter, uint16_t );
+
+	/* The condition groups */
+	for ( i = 0; i < n; i ++ ) {
+		if ( (get_avarchive_varint(&p, end, &u) != 0) || (u > AVR_PACKED_CONDS) ) {
+			return( -1 );
+		}
+		out[i].no_conds = (uint8_t)u;
+	}
+	for ( i = 0; i < n; i ++ ) {
+		if ( get_avarchive_varint(&p, end, &out[i].cond_set) != 0 ) {
+			return( -1 );
+		}
+	}
+	for ( i = 0; i < n; i ++ ) {
+		for ( g = 0; g < out[i].no_conds; g ++ ) {
+			if ( get_avarchive_varint(&p, end, &out[i].conds[g]) != 0 ) {
+				return( -1 );
+			}
+		}
+	}
+
+	/* The cloud layers */
+	for ( i = 0; i < n; i ++ ) {
+		if ( (get_avarchive_varint(&p, end, &u) != 0) || (u > AVR_PACKED_LAYERS) ) {
+			return( -1 );
+		}
+		out[i].no_layers = (uint8_t)u;
+	}
+	for ( i = 0, prev = 0; i < n; i ++ ) {
+		for ( g = 0; g < out[i].no_layers; g ++ ) {
+			if ( get_avarchive_varint(&p, end, &u) != 0 ) {
+				return( -1 );
+			}
+			prev += (uint32_t)AVARCHIVE_UNZIGZAG(u);
+			out[i].layers[g] = (uint16_t)prev;
+		}
+	}
+
+	/* The payload must be used exactly */
+	return( (p == end) ? 0 : -1 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : next_avarchive_block
+// Description  : read the header of the next block of a station
+//
+// Inputs       : pos - the position of the block (advanced to the payload)
+//                end - the end of the blocks of the station
+//                n - the number of readings in the block
+//                len - the length of the payload
+//                first - the time of the first reading
+//                last - the time of the last reading
+// Outputs      : 0 if successful, -1 if the header is corrupt
+*/
+
+static int next_avarchive_block( const uint8_t **pos, const uint8_t *end, unsigned int *n,
+								 uint32_t *len, uint32_t *first, uint32_t *last ) {
+
+	/* Local variables */
+	uint32_t cnt, span;
+
+	/* Read the count, length and times, the payload must lie in the station */
+	if ( (get_avarchive_varint(pos, end, &cnt) != 0) || (get_avarchive_varint(pos, end, len) != 0) ||
+		 (get_avarchive_varint(pos, end, first) != 0) || (get_avarchive_varint(pos, end, &span) != 0) ||
+		 (cnt == 0) || (cnt > AVARCHIVE_BLOCK) || (*len > (size_t)(end - *pos)) || (span > UINT32_MAX - *first) ) {
+		return( -1 );
+	}
+	*n = cnt;
+	*last = *first + span;
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : create_avparser_archive
+// Description  : create an archive to write readings to (the readings are
+//                written when the archive is finished)
+//
+// Inputs       : path - the path of the file to create
+// Outputs      : a pointer to the writer, NULL if the file could not be created
+*/
+
+avarchive_writer * create_avparser_archive( const char *path ) {
+
+	/* Local variables */
+	avarchive_writer *aw;
+	FILE *file;
+
+	/* Create the file, allocate and setup the writer */
+	if ( (file = fopen(path, "wb")) == NULL ) {
+		return( NULL );
+	}
+	if ( (aw = malloc(sizeof(avarchive_writer))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	memset( aw, 0x0, sizeof(avarchive_writer) );
+	aw->file = file;
+	return( aw );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : add_avparser_archive_record
+// Description  : add a packed reading to an archive
+//
+// Inputs       : aw - the archive writer
+//                pkd - the reading to add
+// Outputs      : none
+*/
+
+void add_avparser_archive_record( avarchive_writer *aw, const avreading_packed *pkd ) {
+
+	/* Grow the readings as needed, then add the reading */
+	if ( aw->no_records == aw->size ) {
+		aw->size = (aw->size == 0) ? 1024 : aw->size * 2;
+		if ( (aw->records = realloc(aw->records, aw->size * sizeof(avreading_packed))) == NULL ) {
+			AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+			exit(-1);
+		}
+	}
+	aw->records[aw->no_records++] = *pkd;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : add_avparser_archive
+// Description  : add a reading to an archive, the condition groups and cloud
+//                layers that do not fit a packed record are dropped (the
+//                reading is flagged truncated), a reading whose base fields
+//                do not fit is not added (rejected)
+//
+// Inputs       : aw - the archive writer
+//                avr - the reading to add
+// Outputs      : none
+*/
+
+void add_avparser_archive( avarchive_writer *aw, avreading *avr ) {
+
+	/* Local variables */
+	avreading_packed pkd;
+
+	/* Pack the reading (skip it if it did not pack at all), then add it */
+	if ( pack_avreading(avr, &pkd) != 0 ) {
+		if ( ! (pkd.flags & AVR_PACKED_TRUNCATED) ) {
+			aw->rejected ++;
+			return;
+		}
+		aw->truncated ++;
+	}
+	add_avparser_archive_record( aw, &pkd );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : finish_avparser_archive
+// Description  : finish an archive, the readings are sorted by station and
+//                time and written in blocks, then the index and header, the
+//                file is closed and the writer released
+//
+// Inputs       : aw - the archive writer
+// Outputs      : 0 if successful, -1 if the file could not be written
+*/
+
+int finish_avparser_archive( avarchive_writer *aw ) {
+
+	/* Local variables */
+	avarchive_header hdr;
+	avarchive_station *index;
+	avarchive_key *keys;
+	avreading_packed blk[AVARCHIVE_BLOCK];
+	uint8_t buf[AVARCHIVE_BLOCK * AVARCHIVE_RECORD_MAX], head[AVARCHIVE_HEADER_MAX], *p;
+	uint64_t offset = sizeof(avarchive_header);
+	size_t i, len;
+	unsigned int n, s = 0, no_stations = 0;
+	int err = 0;
+
+	/* Sort the readings by station and time */
+	if ( (keys = malloc((aw->no_records + 1) * sizeof(avarchive_key))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	for ( i = 0; i < aw->no_records; i ++ ) {
+		keys[i].station = aw->records[i].station;
+		keys[i].zulu = aw->records[i].zulu;
+		keys[i].pos = (uint32_t)i;
+	}
+	qsort( keys, aw->no_records, sizeof(avarchive_key), compare_avarchive_keys );
+	for ( i = 0; i < aw->no_records; i ++ ) {
+		no_stations += ((i == 0) || (keys[i].station != keys[i-1].station));
+	}
+	if ( (index = calloc(no_stations + 1, sizeof(avarchive_station))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+
+	/* Reserve the header, then write the blocks of each station */
+	memset( &hdr, 0x0, sizeof(avarchive_header) );
+	err = (fwrite(&hdr, sizeof(avarchive_header), 1, aw->file) != 1);
+	for ( i = 0; (i < aw->no_records) && (! err); i += n ) {
+
+		/* Start the index entry of a new station */
+		if ( (i == 0) || (keys[i].station != keys[i-1].station) ) {
+			s = (i == 0) ? 0 : s + 1;
+			index[s].name[0] = (char)(keys[i].station >> 24);
+			index[s].name[1] = (char)(keys[i].station >> 16);
+			index[s].name[2] = (char)(keys[i].station >> 8);
+			index[s].name[3] = (char)keys[i].station;
+			index[s].offset = offset;
+		}
+
+		/* Gather the block (up to a full block of the station), encode it */
+		for ( n = 0; (n < AVARCHIVE_BLOCK) && (i + n < aw->no_records) &&
+				(keys[i+n].station == keys[i].station); n ++ ) {
+			blk[n] = aw->records[keys[i+n].pos];
+		}
+		len = encode_avarchive_block( blk, n, buf );
+		p = put_avarchive_varint( head, n );
+		p = put_avarchive_varint( p, (uint32_t)len );
+		p = put_avarchive_varint( p, blk[0].zulu );
+		p = put_avarchive_varint( p, blk[n-1].zulu - blk[0].zulu );
+		err = (fwrite(head, p - head, 1, aw->file) != 1) || (fwrite(buf, len, 1, aw->file) != 1);
+		offset += (p - head) + len;
+		index[s].no_records += n;
+		index[s].no_blocks ++;
+		index[s].length = offset - index[s].offset;
+	}
+
+	/* Pad to align the index, write it, then the header (over the one reserved) */
+	len = (sizeof(uint64_t) - (offset % sizeof(uint64_t))) % sizeof(uint64_t);
+	memset( head, 0x0, sizeof(head) );
+	if ( (! err) && (len > 0) && (fwrite(head, len, 1, aw->file) != 1) ) {
+		err = 1;
+	}
+	offset += len;
+	memcpy( hdr.magic, AVARCHIVE_MAGIC, sizeof(hdr.magic) );
+	hdr.version = AVARCHIVE_VERSION;
+	hdr.block = AVARCHIVE_BLOCK;
+	hdr.byte_order = AVARCHIVE_BYTE_ORDER;
+	hdr.no_stations = no_stations;
+	hdr.no_records = aw->no_records;
+	hdr.index = offset;
+	if ( (! err) && (no_stations > 0) &&
+			(fwrite(index, sizeof(avarchive_station), no_stations, aw->file) != no_stations) ) {
+		err = 1;
+	}
+	if ( (! err) && ((fseek(aw->file, 0, SEEK_SET) != 0) ||
+			(fwrite(&hdr, sizeof(avarchive_header), 1, aw->file) != 1)) ) {
+		err = 1;
+	}
+
+	/* Close the file, release the writer */
+	if ( fclose(aw->file) != 0 ) {
+		err = 1;
+	}
+	free( index );
+	free( keys );
+	free( aw->records );
+	free( aw );
+	return( (err) ? -1 : 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_archive
+// Description  : write the readings of parsed input to an archive
+//
+// Inputs       : avout - the parsed input
+//                path - the path of the file to create
+// Outputs      : 0 if successful, -1 if the file could not be written
+*/
+
+int write_avparser_archive( avparser_out *avout, const char *path ) {
+
+	/* Local variables */
+	avarchive_writer *aw;
+	avreading *avr;
+
+	/* Create the archive, add the readings and finish it */
+	if ( (aw = create_avparser_archive(path)) == NULL ) {
+		return( -1 );
+	}
+	for ( avr = avout->readings; avr != NULL; avr = avr->next ) {
+		add_avparser_archive( aw, avr );
+	}
+	return( finish_avparser_archive(aw) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : open_avparser_archive
+// Description  : open an archive for reading, the file is mapped (read only)
+//                and the header and index checked (the blocks are checked as
+//                they are decoded)
+//
+// Inputs       : path - the path of the file to open
+// Outputs      : a pointer to the opened archive, NULL if the file could not
+//                be mapped or is not an archive (of this version, byte order)
+*/
+
+avparser_archive * open_avparser_archive( const char *path ) {
+
+	/* Local variables */
+	avparser_archive *arc;
+	const avarchive_header *hdr;
+	const avarchive_station *ent;
+	struct stat st;
+	size_t len;
+	uint32_t i;
+	void *map;
+	int fd;
+
+	/* Open the file, map it */
+	if ( (fd = open(path, O_RDONLY)) == -1 ) {
+		return( NULL );
+	}
+	if ( (fstat(fd, &st) == -1) || (st.st_size < (off_t)sizeof(avarchive_header)) ) {
+		close( fd );
+		return( NULL );
+	}
+	len = st.st_size;
+	map = mmap( NULL, len, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if ( map == MAP_FAILED ) {
+		return( NULL );
+	}
+
+	/* Check the header, the index must lie in the file */
+	hdr = (const avarchive_header *)map;
+	if ( (memcmp(hdr->magic, AVARCHIVE_MAGIC, sizeof(hdr->magic)) != 0) ||
+		 (hdr->version != AVARCHIVE_VERSION) || (hdr->byte_order != AVARCHIVE_BYTE_ORDER) ||
+		 (hdr->index < sizeof(avarchive_header)) || (hdr->index > len) ||
+		 (hdr->index % sizeof(uint64_t) != 0) ||
+		 (hdr->no_stations > (len - hdr->index) / sizeof(avarchive_station)) ) {
+		munmap( map, len );
+		return( NULL );
+	}
+
+	/* Check the blocks of each station lie before the index */
+	ent = (const avarchive_station *)((const char *)map + hdr->index);
+	for ( i = 0; i < hdr->no_stations; i ++ ) {
+		if ( (ent[i].offset < sizeof(avarchive_header)) || (ent[i].offset > hdr->index) ||
+			 (ent[i].length > hdr->index - ent[i].offset) ) {
+			munmap( map, len );
+			return( NULL );
+		}
+	}
+
+	/* Allocate and setup the archive */
+	if ( (arc = malloc(sizeof(avparser_archive))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	arc->map = map;
+	arc->maplen = len;
+	arc->header = hdr;
+	arc->stations = ent;
+	arc->no_stations = hdr->no_stations;
+	return( arc );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : close_avparser_archive
+// Description  : close an archive (unmap it)
+//
+// Inputs       : arc - the archive to close
+// Outputs      : none
+*/
+
+void close_avparser_archive( avparser_archive *arc ) {
+
+	/* Unmap the file and free the structure */
+	if ( arc != NULL ) {
+		munmap( arc->map, arc->maplen );
+		free( arc );
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : find_avparser_archive_station
+// Description  : find the index entry of a station (binary search)
+//
+// Inputs       : arc - the archive
+//                station - the station (4 letter) code
+// Outputs      : a pointer to the entry, NULL if the station is not archived
+*/
+
+const avarchive_station * find_avparser_archive_station( avparser_archive *arc, const char *station ) {
+
+	/* Local variables */
+	char name[AVARCHIVE_NAME_LEN];
+	uint32_t lo = 0, hi = arc->no_stations, mid;
+	int cmp;
+
+	/* Pad the name as the index does, then search */
+	if ( strnlen(station, AVR_STATION_LEN + 1) != AVR_STATION_LEN ) {
+		return( NULL );
+	}
+	memset( name, 0x0, sizeof(name) );
+	memcpy( name, station, AVR_STATION_LEN );
+	while ( lo < hi ) {
+		mid = lo + (hi - lo) / 2;
+		if ( (cmp = memcmp(arc->stations[mid].name, name, AVARCHIVE_NAME_LEN)) == 0 ) {
+			return( &arc->stations[mid] );
+		}
+		if ( cmp < 0 ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return( NULL );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : read_avparser_archive_station
+// Description  : decode all of the readings of a station (in time order)
+//
+// Inputs       : arc - the archive
+//                ent - the index entry of the station
+//                out - the readings decoded (ent->no_records of them)
+// Outputs      : the number of readings decoded, -1 if the archive is corrupt
+*/
+
+long read_avparser_archive_station( avparser_archive *arc, const avarchive_station *ent, avreading_packed *out ) {
+
+	/* Local variables */
+	const uint8_t *p = (const uint8_t *)arc->map + ent->offset, *end = p + ent->length;
+	uint32_t code = AVR_STATION_CODE(ent->name), len, first, last;
+	unsigned long count = 0;
+	unsigned int n;
+
+	/* Decode each block in turn (straight into the output) */
+	while ( p < end ) {
+		if ( (next_avarchive_block(&p, end, &n, &len, &first, &last) != 0) ||
+			 (n > ent->no_records - count) ||
+			 (decode_avarchive_block(p, p + len, code, first, n, &out[count]) != 0) ) {
+			return( -1 );
+		}
+		p += len;
+		count += n;
+	}
+	return( (count == ent->no_records) ? (long)count : -1 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : query_avparser_archive
+// Description  : get the readings of a station in a time range (inclusive),
+//                blocks outside of the range are skipped without decoding
+//
+// Inputs       : arc - the archive
+//                station - the station (4 letter) code
+//                from - the start of the range (zulu time)
+//                to - the end of the range (zulu time)
+//                out - the array to copy the readings to (oldest first)
+//                max - the number of readings the array holds
+// Outputs      : the number of readings in the range (at most max copied),
+//                -1 if the archive is corrupt
+*/
+
+long query_avparser_archive( avparser_archive *arc, const char *station, time_t from, time_t to,
+							 avreading_packed *out, unsigned int max ) {
+
+	/* Local variables */
+	const avarchive_station *ent;
+	const uint8_t *p, *end;
+	avreading_packed blk[AVARCHIVE_BLOCK];
+	uint32_t code, len, first, last, zfrom, zto;
+	unsigned long count = 0;
+	unsigned int n, i;
+
+	/* Find the station, convert the range (whole minutes) */
+	if ( ((ent = find_avparser_archive_station(arc, station)) == NULL) || (to < from) || (to < 0) ||
+		 ((from + 59) / 60 > UINT32_MAX) ) {
+		return( 0 );
+	}
+	zfrom = (from <= 0) ? 0 : (uint32_t)((from + 59) / 60);
+	zto = (to / 60 > UINT32_MAX) ? UINT32_MAX : (uint32_t)(to / 60);
+
+	/* Walk the blocks, decode those that overlap the range */
+	code = AVR_STATION_CODE(ent->name);
+	p = (const uint8_t *)arc->map + ent->offset;
+	end = p + ent->length;
+	while ( p < end ) {
+		if ( next_avarchive_block(&p, end, &n, &len, &first, &last) != 0 ) {
+			return( -1 );
+		}
+		if ( first > zto ) {
+			break;
+		}
+		if ( last >= zfrom ) {
+			if ( decode_avarchive_block(p, p + len, code, first, n, blk) != 0 ) {
+				return( -1 );
+			}
+			for ( i = 0; i < n; i ++ ) {
+				if ( (blk[i].zulu >= zfrom) && (blk[i].zulu <= zto) ) {
+					if ( count < max ) {
+						out[count] = blk[i];
+					}
+					count ++;
+				}
+			}
+		}
+		p += len;
+	}
+	return( (long)count );
+}
@@ -0,0 +1,91 @@
+#ifndef AVARCHIVE_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avarchive.h
+//  Description   : This file contains the definitions for the compressed
+//                  time series archive of the avparse library, the readings
+//                  are grouped by station (in time order) and each field is
+//                  stored in blocks of deltas (zigzag varint encoded).
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Wed Dec 18 13:22:09 EST 2019
+*/
+
+/** Include Files **/
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <avparse.h>
+#include <avpacked.h>
+
+/** Definitions and Types **/
+#define AVARCHIVE_MAGIC      "AVPA"     /* The file magic (first 4 bytes) */
+#define AVARCHIVE_VERSION    1          /* The version of the file format */
+#define AVARCHIVE_BYTE_ORDER 0x01020304 /* Written native, checked on read */
+#define AVARCHIVE_NAME_LEN   8          /* Size of a station name (padded) */
+#define AVARCHIVE_BLOCK      128        /* The readings in a (full) block */
+#define AVARCHIVE_RECORD_MAX 96         /* The most bytes a reading encodes to */
+
+/* Zigzag encoding of signed deltas (small magnitudes, small varints) */
+#define AVARCHIVE_ZIGZAG(v)   (((uint32_t)(v) << 1) ^ (uint32_t)((int32_t)(v) >> 31))
+#define AVARCHIVE_UNZIGZAG(u) ((int32_t)((u) >> 1) ^ -(int32_t)((u) & 1))
+
+/* The file header (at offset 0), the blocks follow it, then the index */
+typedef struct avarchive_header_struct {
+	char      magic[4];     /* The file magic (AVARCHIVE_MAGIC) */
+	uint16_t  version;      /* The version of the format (AVARCHIVE_VERSION) */
+	uint16_t  block;        /* The readings in a full block */
+	uint32_t  byte_order;   /* AVARCHIVE_BYTE_ORDER as the writer stored it */
+	uint32_t  no_stations;  /* The number of stations in the index */
+	uint64_t  no_records;   /* The number of readings */
+	uint64_t  index;        /* The file offset of the station index */
+	uint8_t   reserved[32]; /* Reserved (zero) */
+} avarchive_header;
+
+_Static_assert( sizeof(avarchive_header) == 64, "archive header must be 64 bytes" );
+
+/* A station index entry (sorted by name), the blocks of the station are
+   stored together, each is (varints) the count, the payload length, the
+   first time and the time span, then the payload (one column per field) */
+typedef struct avarchive_station_struct {
+	char      name[AVARCHIVE_NAME_LEN]; /* The station code (NUL padded) */
+	uint32_t  no_records; /* The number of readings of the station */
+	uint32_t  no_blocks;  /* The number of blocks */
+	uint64_t  offset;     /* The file offset of the first block */
+	uint64_t  length;     /* The length of the blocks */
+} avarchive_station;
+
+/* Writer of an archive, the readings are held (packed) until it is finished,
+   then sorted by station and time and written out */
+typedef struct avarchive_writer_struct {
+	FILE             *file;       /* The file being written */
+	avreading_packed *records;    /* The readings added */
+	size_t            no_records; /* The number of readings added */
+	size_t            size;       /* The number of readings allocated */
+	unsigned long     truncated;  /* Readings with groups that did not fit */
+	unsigned long     rejected;   /* Readings not added (base fields did not fit) */
+} avarchive_writer;
+
+/* An archive opened for reading (a read only mapping of the file) */
+typedef struct avparser_archive_struct {
+	void                    *map;         /* The mapping of the file */
+	size_t                   maplen;      /* The length of the mapping */
+	const avarchive_header  *header;      /* The file header */
+	const avarchive_station *stations;    /* The station index */
+	uint32_t                 no_stations; /* The number of stations */
+} avparser_archive;
+
+/** Functional Prototypes **/
+avarchive_writer *    create_avparser_archive( const char *path );
+void                  add_avparser_archive( avarchive_writer *aw, avreading *avr );
+void                  add_avparser_archive_record( avarchive_writer *aw, const avreading_packed *pkd );
+int                   finish_avparser_archive( avarchive_writer *aw );
+int                   write_avparser_archive( avparser_out *avout, const char *path );
+avparser_archive *    open_avparser_archive( const char *path );
+void                  close_avparser_archive( avparser_archive *arc );
+const avarchive_station * find_avparser_archive_station( avparser_archive *arc, const char *station );
+long                  read_avparser_archive_station( avparser_archive *arc, const avarchive_station *ent, avreading_packed *out );
+long                  query_avparser_archive( avparser_archive *arc, const char *station, time_t from, time_t to, avreading_packed *out, unsigned int max );
+
+#define AVARCHIVE_INCLUDED
+#endif
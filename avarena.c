@@ -0,0 +1,184 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avarena.c
+//  Description   : This file contains the bump (arena) allocator used for the
+//                  parsed data of the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Tue Nov 12 09:14:27 EST 2019
+*/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <avparse.h>
+#include <avarena.h>
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avarena_init
+// Description  : initialize an (empty) arena
+//
+// Inputs       : arena - the arena to initialize
+// Outputs      : none
+*/
+
+void avarena_init( avarena *arena ) {
+
+	/* No chunks until the first allocation */
+	arena->chunks = NULL;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avarena_alloc
+// Description  : allocate memory from the arena (memory is not zeroed)
+//
+// Inputs       : arena - the arena to allocate from
+//                size - the number of bytes to allocate
+// Outputs      : a pointer to the allocated memory
+*/
+
+void * avarena_alloc( avarena *arena, size_t size ) {
+
+	/* Local variables */
+	avarena_chunk *chunk = arena->chunks;
+	size_t chsize;
+	void *ptr;
+
+	/* Round the request up to keep every allocation aligned */
+	size = (size + AVARENA_ALIGNMENT - 1) & ~((size_t)AVARENA_ALIGNMENT - 1);
+
+	/* Grow the arena by a new chunk if the current one is exhausted */
+	if ( (chunk == NULL) || (chunk->size - chunk->used < size) ) {
+		chsize = (size > AVARENA_CHUNK_SIZE) ? size : AVARENA_CHUNK_SIZE;
+		if ( (chunk = malloc(sizeof(avarena_chunk) + chsize)) == NULL ) {
+			AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+			exit(-1);
+		}
+		chunk->size = chsize;
+		chunk->used = 0;
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+
+	/* Bump the allocation pointer, return the memory */
+	ptr = (char *)chunk->data + chunk->used;
+	chunk->used += size;
+	return( ptr );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avarena_strdup
+// Description  : duplicate a string into arena memory
+//
+// Inputs       : arena - the arena to allocate from
+//                str - the string to copy
+// Outputs      : a pointer to the copy of the string
+*/
+
+char * avarena_strdup( avarena *arena, const char *str ) {
+
+	/* Local variables */
+	size_t len = strlen(str) + 1;
+
+	/* Allocate and copy (with terminator) */
+	return( memcpy(avarena_alloc(arena, len), str, len) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avarena_merge
+// Description  : move all of the memory of one arena into another (the
+//                memory stays in place, the source arena is left empty)
+//
+// Inputs       : arena - the arena to move the memory into
+//                from - the arena to take the memory from
+// Outputs      : none
+*/
+
+void avarena_merge( avarena *arena, avarena *from ) {
+
+	/* Local variables */
+	avarena_chunk *last;
+
+	/* Nothing to move */
+	if ( from->chunks == NULL ) {
+		return;
+	}
+
+	/* Link the chunks in behind the current chunk (still allocated from) */
+	last = from->chunks;
+	while ( last->next != NULL ) {
+		last = last->next;
+	}
+	if ( arena->chunks == NULL ) {
+		arena->chunks = from->chunks;
+	} else {
+		last->next = arena->chunks->next;
+		arena->chunks->next = from->chunks;
+	}
+	from->chunks = NULL;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avarena_reset
+// Description  : recycle the memory of the arena, all allocations are freed
+//                but the current chunk is kept for the allocations to come
+//
+// Inputs       : arena - the arena to reset
+// Outputs      : none
+*/
+
+void avarena_reset( avarena *arena ) {
+
+	/* Local variables */
+	avarena_chunk *chunk, *tmp;
+
+	/* Nothing allocated */
+	if ( arena->chunks == NULL ) {
+		return;
+	}
+
+	/* Free all but the current chunk, then empty it */
+	chunk = arena->chunks->next;
+	while ( chunk != NULL ) {
+		tmp = chunk;
+		chunk = chunk->next;
+		free( tmp );
+	}
+	arena->chunks->next = NULL;
+	arena->chunks->used = 0;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avarena_release
+// Description  : release all of the memory held by the arena
+//
+// Inputs       : arena - the arena to release
+// Outputs      : none
+*/
+
+void avarena_release( avarena *arena ) {
+
+	/* Local variables */
+	avarena_chunk *chunk, *tmp;
+
+	/* Walk the chunks and free them */
+	chunk = arena->chunks;
+	while ( chunk != NULL ) {
+		tmp = chunk;
+		chunk = chunk->next;
+		free( tmp );
+	}
+	arena->chunks = NULL;
+	return;
+}
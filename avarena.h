@@ -0,0 +1,41 @@
+#ifndef AVARENA_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avarena.h
+//  Description   : This file contains the definitions for the bump (arena)
+//                  allocator used for the parsed data of the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Tue Nov 12 09:14:27 EST 2019
+*/
+
+/** Include Files **/
+#include <stddef.h>
+
+/** Definitions and Types **/
+#define AVARENA_CHUNK_SIZE (64*1024) /* Default size of an arena chunk */
+#define AVARENA_ALIGNMENT  16        /* Alignment of arena allocations */
+
+/* A single chunk of arena memory */
+typedef struct avarena_chunk_struct {
+	struct avarena_chunk_struct *next;  /* The next (older) chunk */
+	size_t                       size;  /* The usable size of the chunk */
+	size_t                       used;  /* The number of bytes handed out */
+	max_align_t                  data[]; /* The chunk memory itself */
+} avarena_chunk;
+
+/* The arena, a list of chunks allocated from in order */
+typedef struct avarena_struct {
+	avarena_chunk *chunks;  /* The current chunk (head of list) */
+} avarena;
+
+/** Functional Prototypes **/
+void                  avarena_init( avarena *arena );
+void *                avarena_alloc( avarena *arena, size_t size );
+char *                avarena_strdup( avarena *arena, const char *str );
+void                  avarena_merge( avarena *arena, avarena *from );
+void                  avarena_reset( avarena *arena );
+void                  avarena_release( avarena *arena );
+
+#define AVARENA_INCLUDED
+#endif
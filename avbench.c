@@ -0,0 +1,749 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avbench.c
+//  Description   : This file contains the benchmark tool for the avparse
+//                  library (field decoder micro-benchmarks, column scans and
+//                  the parse, print and free phases over a corpus).
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Mon Dec  2 09:41:18 EST 2019
+*/
+
+// Includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <avparse.h>
+#include <avfldparse.h>
+#include <avcorpus.h>
+#include <avcolumn.h>
+#include <avwriter.h>
+
+// Definitions
+#define AVBENCH_ARGUMENTS "hi:n:f:m:r:c:"
+#define AVBENCH_ITERATIONS 2000000
+#define AVBENCH_READINGS 500000
+#define AVBENCH_SCANS 20
+#define AVBENCH_MALFORMED 50   /* One in this many corpus lines is malformed */
+#define AVBENCH_MAX_RESULTS 16 /* The most phase results kept (and compared) */
+#define AVBENCH_USAGE \
+    "\nUSAGE: avbench [-i <iterations>] [-n <readings>] [-f <corpus>] [-m <n>] [-r <results>] [-c <baseline>] [-h]\n" \
+    "\n" \
+    "where:\n" \
+	"    -i - the number of times each field is decoded (default 2000000).\n" \
+	"    -n - the number of readings scanned and parsed (default 500000).\n" \
+	"    -f - time the phases over the <corpus> file (not a generated one).\n" \
+	"    -m - make one in <n> generated lines malformed (default 50, 0 none).\n" \
+	"    -r - record the phase results to the file <results>.\n" \
+	"    -c - compare the phase results with a recorded <baseline>.\n" \
+	"    -h - help mode (display this message)\n\n"
+
+/* The result of a timed phase (as recorded and compared) */
+typedef struct avbench_result_struct {
+	char    name[32];  /* The engine and phase (e.g., grammar.parse) */
+	double  ns;        /* The time per reading (ns) */
+	double  allocs;    /* The allocations per reading (-1 if not counted) */
+	long    rss;       /* The peak resident set size of the phase (KB) */
+} avbench_result;
+
+/* Sample tokens for each of the fields */
+static const char *wind_tokens[] = { "05004KT", "10010KT", "27015KT", "00000KT" };
+static const char *gust_tokens[] = { "10010G27KT", "27015G25KT", "18022G35KT", "09012G20KT" };
+static const char *vis_tokens[]  = { "10SM", "8SM", "5/8SM", "3SM" };
+static const char *cvg_tokens[]  = { "SKC", "SCT050", "BKN120", "OVC002" };
+static const char *altm_tokens[] = { "A3042", "A3027", "A3005", "A2992" };
+static const char *cond_tokens[] = { "+SHRASNPL", "-SN", "TSRAGS", "-DZ" };
+static const char *time_tokens[] = { "021953Z", "010000Z", "152359Z", "281215Z" };
+#define AVBENCH_SAMPLES 4
+
+/* Sink for the decoded values (keeps the work from being optimized away) */
+static volatile long avbench_sink;
+
+/* Count of the allocations made, when linked with the allocators wrapped
+   (the Makefile wraps malloc, calloc and realloc with GNU ld) */
+static unsigned long avbench_allocs;
+#ifdef AVBENCH_ALLOCS
+void * __real_malloc( size_t size );
+void * __real_calloc( size_t count, size_t size );
+void * __real_realloc( void *ptr, size_t size );
+void * __wrap_malloc( size_t size ) { avbench_allocs ++; return( __real_malloc(size) ); }
+void * __wrap_calloc( size_t count, size_t size ) { avbench_allocs ++; return( __real_calloc(count, size) ); }
+void * __wrap_realloc( void *ptr, size_t size ) { avbench_allocs ++; return( __real_realloc(ptr, size) ); }
+#endif
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avbench_now
+// Description  : get a monotonic timestamp
+//
+// Inputs       : none
+// Outputs      : the time in nanoseconds
+*/
+
+static double avbench_now( void ) {
+
+	/* Local variables */
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return( (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avbench_tokens
+// Description  : make token views for a set of sample strings
+//
+// Inputs       : strs - the sample strings
+//                toks - the tokens to fill in
+// Outputs      : none
+*/
+
+static void avbench_tokens( const char **strs, avparser_token *toks ) {
+
+	/* Local variables */
+	int i;
+
+	for ( i = 0; i < AVBENCH_SAMPLES; i ++ ) {
+		toks[i].str = strs[i];
+		toks[i].len = strlen(strs[i]);
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avbench_report
+// Description  : print one line of the field benchmark
+//
+// Inputs       : field - the name of the field
+//                old_ns - the total time for the old (replaced) decoding
+//                new_ns - the total time for the library decoding
+//                iters - the number of iterations timed
+// Outputs      : none
+*/
+
+static void avbench_report( const char *field, double old_ns, double new_ns, long iters ) {
+
+	printf( "%-12s %10.1f %10.1f %8.1fx\n", field, old_ns/iters, new_ns/iters, 
+		(new_ns > 0) ? old_ns/new_ns : 0.0 );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avbench_condition_scan
+// Description  : the linear condition code scan (replaced by the table)
+//
+// Inputs       : cstr - the condition string
+// Outputs      : the sum of the conditions found
+*/
+
+static int avbench_condition_scan( const char *cstr ) {
+
+	/* Local variables */
+	int idx = (cstr[0] == '+') || (cstr[0] == '-'), condnum, sum = 0;
+
+	/* Walk the codes, scan the condition list for each */
+	while ( cstr[idx] != 0x0 ) {
+		for ( condnum = AVR_CONDITION_VC; condnum < AVR_CONDITION_MAX; condnum ++ ) {
+			if ( strncmp(&cstr[idx], avr_condition_strings[condnum][1], 2) == 0 ) {
+				sum += condnum;
+				break;
+			}
+		}
+		idx += 2;
+	}
+	return( sum );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avbench_zulu_mktime
+// Description  : the per-report time conversion (replaced by the time base)
+//
+// Inputs       : tstr - the time string
+// Outputs      : the converted time
+*/
+
+static time_t avbench_zulu_mktime( const char *tstr ) {
+
+	/* Local variables */
+	struct tm adjtime, nowtime;
+	time_t now;
+	int day, hr, mn;
+
+	sscanf( tstr, "%2d%2d%2dZ", &day, &hr, &mn );
+	now = time(NULL);
+	localtime_r( &now, &nowtime );
+	memset( &adjtime, 0x0, sizeof(adjtime) );
+	adjtime.tm_min = mn;
+	adjtime.tm_hour = hr;
+	adjtime.tm_mday = day;
+	adjtime.tm_year = nowtime.tm_year;
+	adjtime.tm_mon = nowtime.tm_mon;
+	return( mktime(&adjtime) + nowtime.tm_gmtoff );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : bench_fields
+// Description  : time the field decoders against the (sscanf, linear scan)
+//                decoding they replaced (ns per field)
+//
+// Inputs       : iters - the number of times to decode each field
+// Outputs      : none
+*/
+
+static void bench_fields( long iters ) {
+
+	/* Local variables */
+	avparser_token toks[AVBENCH_SAMPLES];
+	avreading_wind wind;
+	avreading_coverage cvg;
+	avreading_condition cond;
+	avreading_time avt;
+	avreading_timebase tb;
+	float altm;
+	int a, b, c;
+	unsigned int u;
+	char s[4];
+	double start, mid;
+	long i;
+
+	printf( "%-12s %10s %10s %9s\n", "field", "old ns", "new ns", "speedup" );
+
+	/* Wind (no gust) */
+	avbench_tokens( wind_tokens, toks );
+	start = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		sscanf( wind_tokens[i%AVBENCH_SAMPLES], "%3d%2dKT", &a, &b );
+		avbench_sink += a + b;
+	}
+	mid = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		avbench_sink += parse_wind( toks[i%AVBENCH_SAMPLES], &wind, AVP_NO_GUST ) + wind.direction;
+	}
+	avbench_report( "wind", mid - start, avbench_now() - mid, iters );
+
+	/* Wind with gusts */
+	avbench_tokens( gust_tokens, toks );
+	start = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		sscanf( gust_tokens[i%AVBENCH_SAMPLES], "%3d%2dG%2dKT", &a, &b, &c );
+		avbench_sink += a + b + c;
+	}
+	mid = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		avbench_sink += parse_wind( toks[i%AVBENCH_SAMPLES], &wind, AVP_GUST ) + wind.gust;
+	}
+	avbench_report( "wind gust", mid - start, avbench_now() - mid, iters );
+
+	/* Visibility */
+	avbench_tokens( vis_tokens, toks );
+	start = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		sscanf( vis_tokens[i%AVBENCH_SAMPLES], "%dSM", &a );
+		avbench_sink += a;
+	}
+	mid = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		avbench_sink += parse_visibility( toks[i%AVBENCH_SAMPLES], &u ) + u;
+	}
+	avbench_report( "visibility", mid - start, avbench_now() - mid, iters );
+
+	/* Coverage (the sscanf version includes the name matching) */
+	avbench_tokens( cvg_tokens, toks );
+	start = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		u = 0;
+		sscanf( cvg_tokens[i%AVBENCH_SAMPLES], "%3s%3u", s, &u );
+		avbench_sink += u + (strncasecmp(s, "SKC", 3) == 0) + (strncasecmp(s, "FEW", 3) == 0) +
+			(strncasecmp(s, "SCT", 3) == 0) + (strncasecmp(s, "BKN", 3) == 0);
+	}
+	mid = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		avbench_sink += parse_coverage( toks[i%AVBENCH_SAMPLES], &cvg ) + cvg.altitude;
+	}
+	avbench_report( "coverage", mid - start, avbench_now() - mid, iters );
+
+	/* Weather conditions */
+	avbench_tokens( cond_tokens, toks );
+	start = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		avbench_sink += avbench_condition_scan( cond_tokens[i%AVBENCH_SAMPLES] );
+	}
+	mid = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		avbench_sink += parse_conditions( toks[i%AVBENCH_SAMPLES], &cond ) + cond.conditions[0];
+	}
+	avbench_report( "conditions", mid - start, avbench_now() - mid, iters );
+
+	/* Altimeter */
+	avbench_tokens( altm_tokens, toks );
+	start = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		sscanf( altm_tokens[i%AVBENCH_SAMPLES], "A%d", &a );
+		avbench_sink += a;
+	}
+	mid = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		avbench_sink += parse_altimeter( toks[i%AVBENCH_SAMPLES], &altm ) + altm;
+	}
+	avbench_report( "altimeter", mid - start, avbench_now() - mid, iters );
+
+	/* Zulu time (the new version uses a time base computed once) */
+	avbench_tokens( time_tokens, toks );
+	start = avbench_now();
+	for ( i = 0; i < iters; i ++ ) {
+		avbench_sink += avbench_zulu_mktime( time_tokens[i%AVBENCH_SAMPLES] );
+	}
+	mid = avbench_now();
+	refresh_avreading_timebase( &tb, time(NULL) );
+	for ( i = 0; i < iters; i ++ ) {
+		avbench_sink += parse_zulu_time( toks[i%AVBENCH_SAMPLES], &avt, &tb ) + avt.zulu;
+	}
+	avbench_report( "zulu time", mid - start, avbench_now() - mid, iters );
+
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : bench_scans
+// Description  : time field scans (gust maximum, altimeter mean) over the 
+//                reading list and over the columnar store (ns per reading)
+//
+// Inputs       : readings - the number of readings to scan
+// Outputs      : none
+*/
+
+static void bench_scans( long readings ) {
+
+	/* Local variables */
+	avparser_ctx *ctx;
+	avparser_out *avout;
+	avreading_columns *cols;
+	avreading *avr;
+	char *corpus;
+	size_t len, i;
+	double start, mid, altm;
+	long scan, gust;
+	FILE *out;
+
+	/* Generate and parse a corpus, build the columns */
+	if ( (out = open_memstream(&corpus, &len)) == NULL ) {
+		fprintf( stderr, "Unable to create corpus stream, aborting.\n" );
+		return;
+	}
+	generate_avparser_corpus( out, readings, 1, 0 );
+	fclose( out );
+	ctx = allocate_avparser_ctx();
+	ctx->engine = AVP_ENGINE_DECODER;
+	avout = avreading_metar_parse_region( ctx, corpus, len );
+	cols = build_avreading_columns( avout );
+
+	printf( "\n%-12s %10s %10s %9s\n", "scan", "list ns", "column ns", "speedup" );
+
+	/* Maximum gust, mean altimeter (list) */
+	start = avbench_now();
+	for ( scan = 0; scan < AVBENCH_SCANS; scan ++ ) {
+		gust = 0;
+		altm = 0.0;
+		for ( avr = avout->readings; avr != NULL; avr = avr->next ) {
+			gust = (avr->rwind.gust > gust) ? avr->rwind.gust : gust;
+			altm += avr->raltm;
+		}
+		avbench_sink += gust + (long)(altm / avout->no_readings);
+	}
+
+	/* Maximum gust, mean altimeter (columns) */
+	mid = avbench_now();
+	for ( scan = 0; scan < AVBENCH_SCANS; scan ++ ) {
+		gust = 0;
+		altm = 0.0;
+		for ( i = 0; i < cols->count; i ++ ) {
+			gust = (cols->wind_gust[i] > gust) ? cols->wind_gust[i] : gust;
+			altm += cols->altimeter[i];
+		}
+		avbench_sink += gust + (long)(altm / cols->count);
+	}
+	avbench_report( "gust/altm", mid - start, avbench_now() - mid, AVBENCH_SCANS * (long)cols->count );
+
+	/* Cleanup */
+	release_avreading_columns( cols );
+	release_avparser_struct( avout );
+	release_avparser_ctx( ctx );
+	free( corpus );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avbench_reset_peak
+// Description  : reset the peak resident set size (where the system allows
+//                it, otherwise the peak is that of the whole run)
+//
+// Inputs       : none
+// Outputs      : none
+*/
+
+static void avbench_reset_peak( void ) {
+
+	/* Local variables */
+	int fd;
+
+	/* Linux resets the peak when 5 is written to clear_refs */
+	if ( (fd = open("/proc/self/clear_refs", O_WRONLY)) != -1 ) {
+		if ( write(fd, "5", 1) != 1 ) {
+			avbench_sink ++;
+		}
+		close( fd );
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avbench_peak_rss
+// Description  : get the peak resident set size (since the last reset)
+//
+// Inputs       : none
+// Outputs      : the peak size in KB
+*/
+
+static long avbench_peak_rss( void ) {
+
+	/* Local variables */
+	struct rusage ru;
+	char line[128];
+	long kb = -1;
+	FILE *fl;
+
+	/* The high water mark (Linux), otherwise the peak of the run */
+	if ( (fl = fopen("/proc/self/status", "r")) != NULL ) {
+		while ( (kb == -1) && (fgets(line, sizeof(line), fl) != NULL) ) {
+			if ( strncmp(line, "VmHWM:", 6) == 0 ) {
+				kb = atol( &line[6] );
+			}
+		}
+		fclose( fl );
+	}
+	if ( (kb == -1) && (getrusage(RUSAGE_SELF, &ru) == 0) ) {
+#ifdef __APPLE__
+		kb = ru.ru_maxrss / 1024;
+#else
+		kb = ru.ru_maxrss;
+#endif
+	}
+	return( kb );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avbench_phase
+// Description  : finish timing a phase, report and keep its result
+//
+// Inputs       : res - the result to fill in
+//                name - the engine and phase
+//                start - the time the phase started
+//                allocs - the allocation count when the phase started
+//                lines - the number of lines in the corpus
+//                bytes - the size of the corpus
+//                readings - the number of readings parsed
+//                base - the recorded baseline results (NULL if none)
+//                nbase - the number of baseline results
+// Outputs      : none
+*/
+
+static void avbench_phase( avbench_result *res, const char *name, double start, unsigned long allocs, 
+						   long lines, size_t bytes, long readings, avbench_result *base, int nbase ) {
+
+	/* Local variables */
+	double ns = avbench_now() - start;
+	int i;
+
+	/* Fill in the result */
+	snprintf( res->name, sizeof(res->name), "%s", name );
+	res->ns = (readings > 0) ? ns / readings : 0.0;
+#ifdef AVBENCH_ALLOCS
+	res->allocs = (readings > 0) ? (double)(avbench_allocs - allocs) / readings : 0.0;
+#else
+	(void)allocs;
+	res->allocs = -1.0;
+#endif
+	res->rss = avbench_peak_rss();
+
+	/* Report it (and the change from the baseline, if there is one), the
+	   allocations are n/a if they are not counted */
+	printf( "%-16s %12.0f %9.2f %10.1f", name, lines / (ns / 1e9), 
+		(bytes / (1024.0 * 1024.0)) / (ns / 1e9), res->ns );
+	if ( res->allocs < 0 ) {
+		printf( " %9s", "n/a" );
+	} else {
+		printf( " %9.3f", res->allocs );
+	}
+	printf( " %9.1f", res->rss / 1024.0 );
+	for ( i = 0; i < nbase; i ++ ) {
+		if ( strcmp(base[i].name, name) == 0 ) {
+			printf( " %+8.1f%%", (base[i].ns > 0) ? (res->ns - base[i].ns) * 100.0 / base[i].ns : 0.0 );
+		}
+	}
+	printf( "\n" );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : bench_phases
+// Description  : time the parse, print and free phases over a corpus with
+//                each engine (lines/sec and MB/sec are of the corpus, the
+//                time, allocations and peak memory are per reading/phase)
+//
+// Inputs       : corpus - the corpus text
+//                len - the length of the corpus
+//                base - the recorded baseline results (NULL if none)
+//                nbase - the number of baseline results
+//                res - the results of the phases (AVBENCH_MAX_RESULTS)
+// Outputs      : the number of results
+*/
+
+static int bench_phases( const char *corpus, size_t len, avbench_result *base, int nbase, avbench_result *res ) {
+
+	/* Local variables */
+	static const char *engines[] = { "grammar", "decoder" };
+	avparser_ctx *ctx;
+	avparser_out *avout;
+	avparser_writer *wr;
+	char name[32];
+	double start;
+	unsigned long allocs;
+	long lines = 0, readings, errors;
+	size_t i;
+	int e, fd, n = 0;
+
+	/* Count the lines, open the sink for the printing */
+	for ( i = 0; i < len; i ++ ) {
+		lines += (corpus[i] == '\n');
+	}
+	if ( (fd = open("/dev/null", O_WRONLY)) == -1 ) {
+		fprintf( stderr, "Unable to open /dev/null, aborting.\n" );
+		return( 0 );
+	}
+
+	printf( "\n%-16s %12s %9s %10s %9s %9s%s\n", "phase", "lines/sec", "MB/sec", "ns/reading", 
+		"allocs/rd", "peak MB", (nbase > 0) ? "  vs base" : "" );
+
+	for ( e = 0; e < 2; e ++ ) {
+
+		/* Parse the corpus */
+		ctx = allocate_avparser_ctx();
+		ctx->engine = (e == 0) ? AVP_ENGINE_GRAMMAR : AVP_ENGINE_DECODER;
+		avbench_reset_peak();
+		allocs = avbench_allocs;
+		start = avbench_now();
+		avout = avreading_metar_parse_region( ctx, corpus, len );
+		readings = avout->no_readings;
+		errors = avout->no_errors;
+		snprintf( name, sizeof(name), "%s.parse", engines[e] );
+		avbench_phase( &res[n++], name, start, allocs, lines, len, readings, base, nbase );
+
+		/* Print the readings (text, to /dev/null) */
+		avbench_reset_peak();
+		allocs = avbench_allocs;
+		start = avbench_now();
+		wr = allocate_avparser_writer( NULL, fd );
+		write_parsed_input( wr, avout );
+		release_avparser_writer( wr );
+		snprintf( name, sizeof(name), "%s.print", engines[e] );
+		avbench_phase( &res[n++], name, start, allocs, lines, len, readings, base, nbase );
+
+		/* Free the readings */
+		avbench_reset_peak();
+		allocs = avbench_allocs;
+		start = avbench_now();
+		release_avparser_struct( avout );
+		snprintf( name, sizeof(name), "%s.free", engines[e] );
+		avbench_phase( &res[n++], name, start, allocs, lines, len, readings, base, nbase );
+		release_avparser_ctx( ctx );
+	}
+	printf( "(%ld lines, %.1f MB, %ld readings, %ld bad lines)\n", lines, len / (1024.0 * 1024.0), 
+		readings, errors );
+	close( fd );
+	return( n );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avbench_load_corpus
+// Description  : read a corpus file (or generate one) into memory
+//
+// Inputs       : path - the corpus file (NULL to generate a corpus)
+//                lines - the number of lines to generate
+//                malformed - one in this many generated lines is malformed
+//                len - the length of the corpus
+// Outputs      : the corpus (to free), NULL if it could not be read
+*/
+
+static char * avbench_load_corpus( const char *path, long lines, unsigned int malformed, size_t *len ) {
+
+	/* Local variables */
+	char *corpus = NULL, *more;
+	size_t size = 0, got;
+	FILE *fl;
+
+	/* Generate the corpus in memory */
+	if ( path == NULL ) {
+		if ( (fl = open_memstream(&corpus, len)) == NULL ) {
+			return( NULL );
+		}
+		generate_avparser_corpus( fl, lines, 1, malformed );
+		fclose( fl );
+		return( corpus );
+	}
+
+	/* Read the file (in large pieces) */
+	if ( (fl = fopen(path, "r")) == NULL ) {
+		return( NULL );
+	}
+	*len = 0;
+	do {
+		if ( *len == size ) {
+			size = (size == 0) ? (1024 * 1024) : size * 2;
+			if ( (more = realloc(corpus, size)) == NULL ) {
+				AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+				exit(-1);
+			}
+			corpus = more;
+		}
+		got = fread( &corpus[*len], 1, size - *len, fl );
+		*len += got;
+	} while ( got > 0 );
+	fclose( fl );
+	return( corpus );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avbench_results
+// Description  : read or write a file of phase results (name, ns/reading,
+//                allocations/reading and peak KB on each line)
+//
+// Inputs       : path - the results file
+//                res - the results (read into, or written)
+//                n - the number of results to write (-1 to read)
+// Outputs      : the number of results read or written, -1 on failure
+*/
+
+static int avbench_results( const char *path, avbench_result *res, int n ) {
+
+	/* Local variables */
+	FILE *fl;
+	int i;
+
+	/* Write the results */
+	if ( n >= 0 ) {
+		if ( (fl = fopen(path, "w")) == NULL ) {
+			return( -1 );
+		}
+		for ( i = 0; i < n; i ++ ) {
+			fprintf( fl, "%s %.3f %.3f %ld\n", res[i].name, res[i].ns, res[i].allocs, res[i].rss );
+		}
+		return( (fclose(fl) == 0) ? n : -1 );
+	}
+
+	/* Read the results */
+	if ( (fl = fopen(path, "r")) == NULL ) {
+		return( -1 );
+	}
+	for ( i = 0; (i < AVBENCH_MAX_RESULTS) && (fscanf(fl, "%31s %lf %lf %ld", res[i].name, 
+			&res[i].ns, &res[i].allocs, &res[i].rss) == 4); i ++ );
+	fclose( fl );
+	return( i );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : run the avparse benchmarks
+//
+// Inputs       : argc - the number of command line arguments
+//                argv - the command line arguments
+// Outputs      : 0 if successful, -1 otherwise
+*/
+
+int main(int argc, char **argv) {
+
+	// Local variables
+	int ch, nres, nbase = 0;
+	long iters = AVBENCH_ITERATIONS, readings = AVBENCH_READINGS;
+	unsigned int malformed = AVBENCH_MALFORMED;
+	char *infile = NULL, *record = NULL, *baseline = NULL, *corpus;
+	avbench_result res[AVBENCH_MAX_RESULTS], base[AVBENCH_MAX_RESULTS];
+	size_t len;
+
+	// Process the command line parameters
+    while ((ch = getopt(argc, argv, AVBENCH_ARGUMENTS)) != -1) {
+
+            switch (ch) {
+            case 'h': // Help, print usage
+                    fprintf( stderr, AVBENCH_USAGE );
+                    return( -1 );
+
+            case 'i': // Iterations
+            		iters = atol(optarg);
+            		break;
+
+            case 'n': // Readings scanned
+            		readings = atol(optarg);
+            		break;
+
+            case 'f': // Corpus file
+            		infile = optarg;
+            		break;
+
+            case 'm': // Malformed lines
+            		malformed = (unsigned int)atoi(optarg);
+            		break;
+
+            case 'r': // Record the results
+            		record = optarg;
+            		break;
+
+            case 'c': // Compare with a baseline
+            		baseline = optarg;
+            		break;
+
+            default:  // Default (unknown)
+                    fprintf( stderr, "Unknown command line option (%c), aborting.\n", ch );
+                    return( -1 );
+            }
+    }
+
+    // Read the baseline (if any)
+    if ( (baseline != NULL) && ((nbase = avbench_results(baseline, base, -1)) < 0) ) {
+    	fprintf( stderr, "Unable to read baseline (%s), aborting.\n", baseline );
+    	return( -1 );
+    }
+
+    // Run the field and scan benchmarks
+    bench_fields( iters );
+    bench_scans( readings );
+
+    // Run the phase benchmarks, record the results
+    if ( (corpus = avbench_load_corpus(infile, readings, malformed, &len)) == NULL ) {
+    	fprintf( stderr, "Unable to read corpus (%s), aborting.\n", infile );
+    	return( -1 );
+    }
+    nres = bench_phases( corpus, len, base, nbase, res );
+    free( corpus );
+    if ( (record != NULL) && (avbench_results(record, res, nres) < 0) ) {
+    	fprintf( stderr, "Unable to record results (%s), aborting.\n", record );
+    	return( -1 );
+    }
+	return( 0 );
+}
@@ -0,0 +1,294 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avbinary.c
+//  Description   : This file contains the binary (on disk) file format of the
+//                  avparse library, parsed readings are written as fixed size
+//                  (packed) records and read back by mapping the file, the
+//                  records are used in place with no decode step.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Mon Dec 16 09:41:27 EST 2019
+*/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <avparse.h>
+#include <avpacked.h>
+#include <avfilter.h>
+#include <avbinary.h>
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : compare_avbinary_codes
+// Description  : compare two packed station codes (qsort callback)
+//
+// Inputs       : a, b - the codes to compare
+// Outputs      : -1, 0 or 1 as a is less than, equal to or greater than b
+*/
+
+static int compare_avbinary_codes( const void *a, const void *b ) {
+
+	/* Local variables */
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	/* Compare the codes (the order of the station names) */
+	return( (x < y) ? -1 : (x > y) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : create_avparser_binary
+// Description  : create a binary file to write readings to (the header is
+//                written when the file is finished)
+//
+// Inputs       : path - the path of the file to create
+// Outputs      : a pointer to the writer, NULL if the file could not be created
+*/
+
+avbinary_writer * create_avparser_binary( const char *path ) {
+
+	/* Local variables */
+	avbinary_writer *bw;
+	avbinary_header hdr;
+	FILE *file;
+
+	/* Create the file, reserve the header */
+	if ( (file = fopen(path, "wb")) == NULL ) {
+		return( NULL );
+	}
+	memset( &hdr, 0x0, sizeof(avbinary_header) );
+	if ( fwrite(&hdr, sizeof(avbinary_header), 1, file) != 1 ) {
+		fclose( file );
+		return( NULL );
+	}
+
+	/* Allocate and setup the writer */
+	if ( (bw = malloc(sizeof(avbinary_writer))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	memset( bw, 0x0, sizeof(avbinary_writer) );
+	bw->file = file;
+	bw->stations = allocate_avparser_station_set();
+	return( bw );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : add_avparser_binary
+// Description  : add a reading to a binary file (as the next record), the
+//                condition groups and cloud layers that do not fit a record
+//                are dropped (the record is flagged truncated), a reading 
+//                whose base fields do not fit is not written (rejected)
+//
+// Inputs       : bw - the binary file writer
+//                avr - the reading to add
+// Outputs      : none
+*/
+
+void add_avparser_binary( avbinary_writer *bw, avreading *avr ) {
+
+	/* Local variables */
+	avreading_packed pkd;
+
+	/* Pack the reading (skip it if it did not pack at all) */
+	if ( pack_avreading(avr, &pkd) != 0 ) {
+		if ( ! (pkd.flags & AVR_PACKED_TRUNCATED) ) {
+			bw->rejected ++;
+			return;
+		}
+		bw->truncated ++;
+	}
+
+	/* Write the record and note the station */
+	if ( fwrite(&pkd, sizeof(avreading_packed), 1, bw->file) != 1 ) {
+		bw->error = 1;
+	}
+	add_avparser_station_code( bw->stations, pkd.station );
+	bw->no_records ++;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : finish_avparser_binary
+// Description  : finish a binary file, write the station table (sorted) and
+//                the header, then close the file and release the writer
+//
+// Inputs       : bw - the binary file writer
+// Outputs      : 0 if successful, -1 if the file could not be written
+*/
+
+int finish_avparser_binary( avbinary_writer *bw ) {
+
+	/* Local variables */
+	avbinary_header hdr;
+	avbinary_station ent;
+	uint32_t *codes;
+	unsigned int i, n = 0;
+	int err = bw->error;
+
+	/* Collect and sort the station codes, write the table after the records */
+	if ( (codes = malloc((bw->stations->count + 1) * sizeof(uint32_t))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	for ( i = 0; i < bw->stations->size; i ++ ) {
+		if ( bw->stations->codes[i] != 0 ) {
+			codes[n++] = bw->stations->codes[i];
+		}
+	}
+	qsort( codes, n, sizeof(uint32_t), compare_avbinary_codes );
+	for ( i = 0; (i < n) && (! err); i ++ ) {
+		memset( &ent, 0x0, sizeof(avbinary_station) );
+		ent.name[0] = (char)(codes[i] >> 24);
+		ent.name[1] = (char)(codes[i] >> 16);
+		ent.name[2] = (char)(codes[i] >> 8);
+		ent.name[3] = (char)codes[i];
+		err = (fwrite(&ent, sizeof(avbinary_station), 1, bw->file) != 1);
+	}
+	free( codes );
+
+	/* Write the header (over the one reserved) */
+	memset( &hdr, 0x0, sizeof(avbinary_header) );
+	memcpy( hdr.magic, AVBINARY_MAGIC, sizeof(hdr.magic) );
+	hdr.version = AVBINARY_VERSION;
+	hdr.record_size = sizeof(avreading_packed);
+	hdr.byte_order = AVBINARY_BYTE_ORDER;
+	hdr.no_stations = n;
+	hdr.no_records = bw->no_records;
+	hdr.records = sizeof(avbinary_header);
+	hdr.stations = hdr.records + (bw->no_records * sizeof(avreading_packed));
+	if ( (! err) && ((fseek(bw->file, 0, SEEK_SET) != 0) ||
+			(fwrite(&hdr, sizeof(avbinary_header), 1, bw->file) != 1)) ) {
+		err = 1;
+	}
+
+	/* Close the file, release the writer */
+	if ( fclose(bw->file) != 0 ) {
+		err = 1;
+	}
+	release_avparser_station_set( bw->stations );
+	free( bw );
+	return( (err) ? -1 : 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_binary
+// Description  : write the readings of parsed input to a binary file
+//
+// Inputs       : avout - the parsed input
+//                path - the path of the file to create
+// Outputs      : 0 if successful, -1 if the file could not be written
+*/
+
+int write_avparser_binary( avparser_out *avout, const char *path ) {
+
+	/* Local variables */
+	avbinary_writer *bw;
+	avreading *avr;
+
+	/* Create the file, add the readings (in order) and finish it */
+	if ( (bw = create_avparser_binary(path)) == NULL ) {
+		return( -1 );
+	}
+	for ( avr = avout->readings; avr != NULL; avr = avr->next ) {
+		add_avparser_binary( bw, avr );
+	}
+	return( finish_avparser_binary(bw) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : open_avparser_binary
+// Description  : open a binary file for reading, the file is mapped (read
+//                only) and checked, the records and station table are used
+//                in place in the mapping
+//
+// Inputs       : path - the path of the file to open
+// Outputs      : a pointer to the opened file, NULL if the file could not be
+//                mapped or is not a binary file (of this version, byte order)
+*/
+
+avparser_binary * open_avparser_binary( const char *path ) {
+
+	/* Local variables */
+	avparser_binary *bin;
+	const avbinary_header *hdr;
+	struct stat st;
+	size_t len;
+	void *map;
+	int fd;
+
+	/* Open the file, map it */
+	if ( (fd = open(path, O_RDONLY)) == -1 ) {
+		return( NULL );
+	}
+	if ( (fstat(fd, &st) == -1) || (st.st_size < (off_t)sizeof(avbinary_header)) ) {
+		close( fd );
+		return( NULL );
+	}
+	len = st.st_size;
+	map = mmap( NULL, len, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if ( map == MAP_FAILED ) {
+		return( NULL );
+	}
+
+	/* Check the header, the records and stations must lie in the file */
+	hdr = (const avbinary_header *)map;
+	if ( (memcmp(hdr->magic, AVBINARY_MAGIC, sizeof(hdr->magic)) != 0) ||
+		 (hdr->version != AVBINARY_VERSION) || (hdr->byte_order != AVBINARY_BYTE_ORDER) ||
+		 (hdr->record_size != sizeof(avreading_packed)) ||
+		 (hdr->records < sizeof(avbinary_header)) || (hdr->records > len) ||
+		 (hdr->records % sizeof(uint32_t) != 0) ||
+		 (hdr->no_records > (len - hdr->records) / sizeof(avreading_packed)) ||
+		 (hdr->stations > len) ||
+		 (hdr->no_stations > (len - hdr->stations) / sizeof(avbinary_station)) ) {
+		munmap( map, len );
+		return( NULL );
+	}
+	madvise( map, len, MADV_WILLNEED );
+
+	/* Allocate and setup the views into the mapping */
+	if ( (bin = malloc(sizeof(avparser_binary))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	bin->map = map;
+	bin->maplen = len;
+	bin->header = hdr;
+	bin->records = (const avreading_packed *)((const char *)map + hdr->records);
+	bin->no_records = hdr->no_records;
+	bin->stations = (const avbinary_station *)((const char *)map + hdr->stations);
+	bin->no_stations = hdr->no_stations;
+	return( bin );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : close_avparser_binary
+// Description  : close a binary file (unmap it), the records can no longer
+//                be used
+//
+// Inputs       : bin - the file to close
+// Outputs      : none
+*/
+
+void close_avparser_binary( avparser_binary *bin ) {
+
+	/* Unmap the file and free the structure */
+	if ( bin != NULL ) {
+		munmap( bin->map, bin->maplen );
+		free( bin );
+	}
+	return;
+}
@@ -0,0 +1,79 @@
+#ifndef AVBINARY_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avbinary.h
+//  Description   : This file contains the definitions for the binary (on disk)
+//                  file format of parsed readings of the avparse library, a
+//                  header, the fixed size (packed) records and a table of the
+//                  stations, read in place through a memory mapping.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Mon Dec 16 09:41:27 EST 2019
+*/
+
+/** Include Files **/
+#include <stdio.h>
+#include <stdint.h>
+#include <avparse.h>
+#include <avpacked.h>
+#include <avfilter.h>
+
+/** Definitions and Types **/
+#define AVBINARY_MAGIC      "AVPB"     /* The file magic (first 4 bytes) */
+#define AVBINARY_VERSION    1          /* The version of the file format */
+#define AVBINARY_BYTE_ORDER 0x01020304 /* Written native, checked on read */
+#define AVBINARY_NAME_LEN   8          /* Size of a station table entry */
+
+/* The file header (at offset 0), the records follow it, then the stations */
+typedef struct avbinary_header_struct {
+	char      magic[4];     /* The file magic (AVBINARY_MAGIC) */
+	uint16_t  version;      /* The version of the format (AVBINARY_VERSION) */
+	uint16_t  record_size;  /* The size of a record, sizeof(avreading_packed) */
+	uint32_t  byte_order;   /* AVBINARY_BYTE_ORDER as the writer stored it */
+	uint32_t  no_stations;  /* The number of stations in the table */
+	uint64_t  no_records;   /* The number of records */
+	uint64_t  records;      /* The file offset of the records */
+	uint64_t  stations;     /* The file offset of the station table */
+	uint8_t   reserved[24]; /* Reserved (zero) */
+} avbinary_header;
+
+_Static_assert( sizeof(avbinary_header) == 64, "binary header must be 64 bytes" );
+
+/* A station table entry, the (NUL padded) station code, sorted by code */
+typedef struct avbinary_station_struct {
+	char      name[AVBINARY_NAME_LEN]; /* The station code */
+} avbinary_station;
+
+/* Writer of a binary file, the records are written as they are added and
+   the station table and header when it is finished */
+typedef struct avbinary_writer_struct {
+	FILE                 *file;      /* The file being written */
+	avparser_station_set *stations;  /* The stations of the records */
+	uint64_t              no_records; /* The number of records written */
+	unsigned long         truncated; /* Records with groups that did not fit */
+	unsigned long         rejected;  /* Readings not written (base fields did not fit) */
+	int                   error;     /* Flag indicating a write failed */
+} avbinary_writer;
+
+/* A binary file opened for reading, the records and stations are views into
+   the (read only) mapping of the file */
+typedef struct avparser_binary_struct {
+	void                   *map;         /* The mapping of the file */
+	size_t                  maplen;      /* The length of the mapping */
+	const avbinary_header  *header;      /* The file header */
+	const avreading_packed *records;     /* The records (in input order) */
+	uint64_t                no_records;  /* The number of records */
+	const avbinary_station *stations;    /* The station table */
+	uint32_t                no_stations; /* The number of stations */
+} avparser_binary;
+
+/** Functional Prototypes **/
+avbinary_writer *     create_avparser_binary( const char *path );
+void                  add_avparser_binary( avbinary_writer *bw, avreading *avr );
+int                   finish_avparser_binary( avbinary_writer *bw );
+int                   write_avparser_binary( avparser_out *avout, const char *path );
+avparser_binary *     open_avparser_binary( const char *path );
+void                  close_avparser_binary( avparser_binary *bin );
+
+#define AVBINARY_INCLUDED
+#endif
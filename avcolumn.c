@@ -0,0 +1,134 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avcolumn.c
+//  Description   : This file contains the columnar (struct of arrays) reading
+//                  store of the avparse library, each field of the readings
+//                  is held in its own contiguous array for fast scans.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Mon Dec  2 15:12:40 EST 2019
+*/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <avparse.h>
+#include <avcolumn.h>
+
+/* Definitions */
+#define AVCOL_ALLOC(cols, n, type) ((type *)avarena_alloc(&(cols)->arena, ((n) > 0 ? (n) : 1) * sizeof(type)))
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : build_avreading_columns
+// Description  : build the columnar store for the readings of a parser 
+//                output (the output is not changed, and may be released)
+//
+// Inputs       : avout - parser output structure
+// Outputs      : a pointer to the new columnar store
+*/
+
+avreading_columns * build_avreading_columns( avparser_out *avout ) {
+
+	/* Local variables */
+	avreading_columns *cols;
+	avreading *avr;
+	avreading_condition *cond;
+	avreading_coverage *cvg;
+	size_t i, c, l, k;
+
+	/* Create the structure */
+	if ( (cols = malloc(sizeof(avreading_columns))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	memset( cols, 0x0, sizeof(avreading_columns) );
+	avarena_init( &cols->arena );
+
+	/* Size the columns (readings, condition groups and layers) */
+	for ( avr = avout->readings; avr != NULL; avr = avr->next ) {
+		cols->count ++;
+		for ( cond = avr->rcond; cond != NULL; cond = cond->next ) {
+			cols->no_conditions ++;
+		}
+		for ( cvg = avr->rcvrg; cvg != NULL; cvg = cvg->next ) {
+			cols->no_layers ++;
+		}
+	}
+
+	/* Allocate the columns */
+	cols->station = AVCOL_ALLOC( cols, cols->count, uint32_t );
+	cols->zulu = AVCOL_ALLOC( cols, cols->count, time_t );
+	cols->local = AVCOL_ALLOC( cols, cols->count, time_t );
+	cols->corrected = AVCOL_ALLOC( cols, cols->count, uint8_t );
+	cols->wind_speed = AVCOL_ALLOC( cols, cols->count, int );
+	cols->wind_direction = AVCOL_ALLOC( cols, cols->count, int );
+	cols->wind_gust = AVCOL_ALLOC( cols, cols->count, int );
+	cols->visibility = AVCOL_ALLOC( cols, cols->count, unsigned int );
+	cols->temperature = AVCOL_ALLOC( cols, cols->count, int );
+	cols->dewpoint = AVCOL_ALLOC( cols, cols->count, int );
+	cols->altimeter = AVCOL_ALLOC( cols, cols->count, float );
+	cols->cond_offset = AVCOL_ALLOC( cols, cols->count + 1, size_t );
+	cols->cond_intensity = AVCOL_ALLOC( cols, cols->no_conditions, uint8_t );
+	cols->cond_codes = AVCOL_ALLOC( cols, cols->no_conditions * AVR_MAX_CONDS, uint8_t );
+	cols->layer_offset = AVCOL_ALLOC( cols, cols->count + 1, size_t );
+	cols->layer_coverage = AVCOL_ALLOC( cols, cols->no_layers, uint8_t );
+	cols->layer_altitude = AVCOL_ALLOC( cols, cols->no_layers, unsigned int );
+
+	/* Walk the readings, fill in the columns */
+	i = c = l = 0;
+	for ( avr = avout->readings; avr != NULL; avr = avr->next ) {
+		cols->station[i] = AVR_STATION_CODE( avr->field );
+		cols->zulu[i] = avr->rtime.zulu;
+		cols->local[i] = avr->rtime.local;
+		cols->corrected[i] = (uint8_t)avr->rcorr;
+		cols->wind_speed[i] = avr->rwind.speed;
+		cols->wind_direction[i] = avr->rwind.direction;
+		cols->wind_gust[i] = avr->rwind.gust;
+		cols->visibility[i] = avr->rviz;
+		cols->temperature[i] = avr->rtemp.temperature_celsisus;
+		cols->dewpoint[i] = avr->rtemp.dewpoint_celsisus;
+		cols->altimeter[i] = avr->raltm;
+
+		/* Conditions and layers go in the side columns */
+		cols->cond_offset[i] = c;
+		for ( cond = avr->rcond; cond != NULL; cond = cond->next ) {
+			cols->cond_intensity[c] = (uint8_t)cond->intensity;
+			for ( k = 0; k < AVR_MAX_CONDS; k ++ ) {
+				cols->cond_codes[(c * AVR_MAX_CONDS) + k] = (uint8_t)cond->conditions[k];
+			}
+			c ++;
+		}
+		cols->layer_offset[i] = l;
+		for ( cvg = avr->rcvrg; cvg != NULL; cvg = cvg->next ) {
+			cols->layer_coverage[l] = (uint8_t)cvg->coverage;
+			cols->layer_altitude[l] = cvg->altitude;
+			l ++;
+		}
+		i ++;
+	}
+	cols->cond_offset[i] = c;
+	cols->layer_offset[i] = l;
+
+	/* Return the columns */
+	return( cols );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : release_avreading_columns
+// Description  : release the columnar store
+//
+// Inputs       : cols - the columnar store to release
+// Outputs      : none
+*/
+
+void release_avreading_columns( avreading_columns *cols ) {
+
+	/* Release the columns, then the structure */
+	avarena_release( &cols->arena );
+	free( cols );
+	return;
+}
@@ -0,0 +1,54 @@
+#ifndef AVCOLUMN_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avcolumn.h
+//  Description   : This file contains the definitions for the columnar 
+//                  (struct of arrays) reading store of the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Mon Dec  2 15:12:40 EST 2019
+*/
+
+/** Include Files **/
+#include <stdint.h>
+#include <time.h>
+#include <avparse.h>
+
+/** Definitions and Types **/
+
+/* The readings of a parser output as columns (one entry per reading, in 
+   order), the conditions and cloud layers of reading i are the entries 
+   [offset[i], offset[i+1]) of their side columns */
+typedef struct avreading_columns_struct {
+	size_t          count;           /* The number of readings */
+	uint32_t       *station;         /* The packed station codes */
+	time_t         *zulu;            /* The (zulu) time of the readings */
+	time_t         *local;           /* The local time of the readings */
+	uint8_t        *corrected;       /* Flags indicating corrected reports */
+	int            *wind_speed;      /* The wind speed, in kts */
+	int            *wind_direction;  /* The wind direction (0-359) */
+	int            *wind_gust;       /* The wind gust (-1 no gust) */
+	unsigned int   *visibility;      /* The visibility (in SM) */
+	int            *temperature;     /* The temperature (celsisus) */
+	int            *dewpoint;        /* The dewpoint (celsisus) */
+	float          *altimeter;       /* The altimeter reading */
+
+	size_t          no_conditions;   /* The number of condition groups */
+	size_t         *cond_offset;     /* Reading to first group (count+1) */
+	uint8_t        *cond_intensity;  /* The intensity of each group */
+	uint8_t        *cond_codes;      /* The conditions (AVR_MAX_CONDS a group) */
+
+	size_t          no_layers;       /* The number of cloud layers */
+	size_t         *layer_offset;    /* Reading to first layer (count+1) */
+	uint8_t        *layer_coverage;  /* The coverage of each layer */
+	unsigned int   *layer_altitude;  /* The altitude of each layer */
+
+	avarena         arena;           /* Memory for the columns */
+} avreading_columns;
+
+/** Functional Prototypes **/
+avreading_columns *   build_avreading_columns( avparser_out *avout );
+void                  release_avreading_columns( avreading_columns *cols );
+
+#define AVCOLUMN_INCLUDED
+#endif
@@ -0,0 +1,150 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avcorpus.c
+//  Description   : This file contains the synthetic METAR corpus generator,
+//                  used to check and exercise the parsing engines.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Fri Nov 22 14:37:09 EST 2019
+*/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <avcorpus.h>
+
+/* Definitions */
+#define AVC_RAND(seed, n) (rand_r(seed) % (n))
+#define AVC_LINE_MAX 256   /* Longest line generated */
+#define AVC_MINOR_STATIONS 2000 /* Number of (synthetic) minor stations */
+
+/* Append to the line being generated */
+#define AVC_PUT(...) (pos += snprintf(&buf[pos], sizeof(buf) - pos, __VA_ARGS__))
+
+/* Local data */
+
+/* Stations the reports are generated for (the busy half of the reports) */
+static const char *avc_stations[] = {
+	"KUNV", "KJFK", "KLAX", "KORD", "KATL", "KDEN", "KSEA", "KBOS",
+	"KPHL", "KPIT", "KIAD", "KDCA", "KMIA", "KSFO", "KLAS", "KPHX",
+};
+#define AVC_NO_STATIONS (sizeof(avc_stations)/sizeof(avc_stations[0]))
+
+/* Common weather condition codes */
+static const char *avc_conditions[] = {
+	"RA", "SN", "DZ", "BR", "FG", "HZ", "TS", "SH", "FZ", "PL", "GR", "VC",
+};
+#define AVC_NO_CONDITIONS (sizeof(avc_conditions)/sizeof(avc_conditions[0]))
+
+/* Cloud layer coverages (with altitude) */
+static const char *avc_coverages[] = { "FEW", "SCT", "BKN", "OVC" };
+
+/* Visibilities other than the common 10SM */
+static const char *avc_visibilities[] = {
+	"1/2SM", "3/4SM", "5/8SM", "1SM", "2SM", "3SM", "4SM", "5SM", "7SM", "9SM",
+};
+#define AVC_NO_VISIBILITIES (sizeof(avc_visibilities)/sizeof(avc_visibilities[0]))
+
+/* Groups real reports carry that the parser does not accept */
+static const char *avc_extras[] = {
+	"AUTO", "RMK AO2", "VRB03KT", "M1/4SM", "////", "NOSIG",
+};
+#define AVC_NO_EXTRAS (sizeof(avc_extras)/sizeof(avc_extras[0]))
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : generate_avparser_corpus
+// Description  : write a synthetic METAR corpus, one report per line, half
+//                of the reports from a few busy stations and the rest spread
+//                over many minor ones, with (if asked) some malformed lines
+//                (cut short, a garbled character or an unsupported group)
+//
+// Inputs       : out - the file to write the corpus to
+//                lines - the number of reports to generate
+//                seed - the random seed (same seed, same corpus)
+//                bad - one in this many lines is malformed (0 for none)
+// Outputs      : the number of lines written
+*/
+
+long generate_avparser_corpus( FILE *out, long lines, unsigned int seed, unsigned int bad ) {
+
+	/* Local variables */
+	char buf[AVC_LINE_MAX];
+	long line;
+	int i, j, pos, groups, codes, layers, alt, temp, dew, speed, minor;
+
+	for ( line = 0; line < lines; line ++ ) {
+
+		/* Station (busy or minor), time and (rarely) a correction */
+		pos = 0;
+		if ( AVC_RAND(&seed, 2) == 0 ) {
+			AVC_PUT( "%s", avc_stations[AVC_RAND(&seed, AVC_NO_STATIONS)] );
+		} else {
+			minor = AVC_RAND(&seed, AVC_MINOR_STATIONS);
+			AVC_PUT( "K%c%c%c", 'A' + (minor / 676) % 26, 'A' + (minor / 26) % 26, 'A' + minor % 26 );
+		}
+		AVC_PUT( " %02d%02d%02dZ%s", AVC_RAND(&seed, 28) + 1, AVC_RAND(&seed, 24), AVC_RAND(&seed, 60),
+			(AVC_RAND(&seed, 50) == 0) ? " COR" : "" );
+
+		/* Wind, some of which is gusting */
+		speed = AVC_RAND(&seed, 30);
+		AVC_PUT( " %03d%02d", AVC_RAND(&seed, 36) * 10, speed );
+		if ( AVC_RAND(&seed, 7) == 0 ) {
+			AVC_PUT( "G%02d", speed + 5 + AVC_RAND(&seed, 20) );
+		}
+		AVC_PUT( "KT %s", (AVC_RAND(&seed, 3) != 0) ? "10SM" : 
+			avc_visibilities[AVC_RAND(&seed, AVC_NO_VISIBILITIES)] );
+
+		/* Weather conditions (two unsigned codes would scan as a station) */
+		groups = (AVC_RAND(&seed, 3) == 0) ? AVC_RAND(&seed, 3) + 1 : 0;
+		for ( i = 0; i < groups; i ++ ) {
+			codes = AVC_RAND(&seed, 3) + 1;
+			j = AVC_RAND(&seed, 3); /* 0 - none, 1 - light, 2 - heavy */
+			j = ((j == 0) && (codes == 2)) ? 1 : j;
+			AVC_PUT( " %s", (j == 1) ? "-" : ((j == 2) ? "+" : "") );
+			for ( j = 0; j < codes; j ++ ) {
+				AVC_PUT( "%s", avc_conditions[AVC_RAND(&seed, AVC_NO_CONDITIONS)] );
+			}
+		}
+
+		/* Cloud layers, clear or up to four layers going up */
+		if ( AVC_RAND(&seed, 4) == 0 ) {
+			AVC_PUT( " %s", AVC_RAND(&seed, 2) ? "SKC" : "CLR" );
+		} else {
+			layers = AVC_RAND(&seed, 4) + 1;
+			for ( i = 0, alt = 0; i < layers; i ++ ) {
+				alt += AVC_RAND(&seed, 60) + 1;
+				AVC_PUT( " %s%03d", avc_coverages[AVC_RAND(&seed, 4)], alt );
+			}
+		}
+
+		/* Temperature/dewpoint and altimeter */
+		temp = AVC_RAND(&seed, 66) - 30;
+		dew = temp - AVC_RAND(&seed, 15);
+		dew = (dew < -40) ? -40 : dew;
+		AVC_PUT( " %s%02d/%s%02d A%04d", (temp < 0) ? "M" : "", abs(temp), 
+			(dew < 0) ? "M" : "", abs(dew), 2900 + AVC_RAND(&seed, 200) );
+
+		/* Malform some lines (cut short, garble a character, add a group) */
+		if ( (bad > 0) && (AVC_RAND(&seed, bad) == 0) ) {
+			switch ( AVC_RAND(&seed, 3) ) {
+			case 0:
+				pos = AVC_RAND(&seed, pos);
+				break;
+			case 1:
+				buf[AVC_RAND(&seed, pos)] = "#/?$"[AVC_RAND(&seed, 4)];
+				break;
+			default:
+				AVC_PUT( " %s", avc_extras[AVC_RAND(&seed, AVC_NO_EXTRAS)] );
+				break;
+			}
+		}
+		buf[pos] = '\n';
+		fwrite( buf, 1, pos + 1, out );
+	}
+
+	/* Return the number of lines written */
+	return( lines );
+}
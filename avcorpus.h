@@ -0,0 +1,19 @@
+#ifndef AVCORPUS_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avcorpus.h
+//  Description   : This file contains the definitions for the synthetic METAR
+//                  corpus generator of the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Fri Nov 22 14:37:09 EST 2019
+*/
+
+/** Include Files **/
+#include <stdio.h>
+
+/** Functional Prototypes **/
+long                  generate_avparser_corpus( FILE *out, long lines, unsigned int seed, unsigned int bad );
+
+#define AVCORPUS_INCLUDED
+#endif
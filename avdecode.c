@@ -0,0 +1,361 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avdecode.c
+//  Description   : This file contains the hand written (single pass) METAR 
+//                  line decoder, an alternative engine to the flex scanner
+//                  and bison grammar.  It accepts exactly what the grammar 
+//                  accepts and fills the readings with the same results.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Thu Nov 21 10:02:44 EST 2019
+*/
+
+/* Includes */
+#include <string.h>
+#include <avparse.h>
+#include <avfldparse.h>
+#include <avdecode.h>
+#include <avstats.h>
+
+/* Definitions */
+#define AVD_DIGIT(c) ((unsigned char)((c) - '0') < 10)
+#define AVD_UPPER(c) ((unsigned char)((c) - 'A') < 26)
+#define AVD_SPACE(c) (((c) == ' ') || ((c) == '\t'))
+
+/* Token types of the decoder (same as the scanner tokens) */
+typedef enum avdecode_token_enum {
+	AVD_AIRPORT     = 0,  /* Station (airfield) code */
+	AVD_ZULUTIME    = 1,  /* Day and zulu time of the report */
+	AVD_CORRECTION  = 2,  /* Corrected report marker */
+	AVD_VISIBILITY  = 3,  /* Visibility */
+	AVD_WIND        = 4,  /* Wind */
+	AVD_WINDGUST    = 5,  /* Wind with gusts */
+	AVD_CONDITION   = 6,  /* Weather conditions */
+	AVD_COVERAGE    = 7,  /* Cloud layer */
+	AVD_TEMPERATURE = 8,  /* Temperature/dewpoint */
+	AVD_ALTIMETER   = 9,  /* Altimeter setting */
+	AVD_EOL         = 10, /* End of the line */
+	AVD_UNKNOWN     = 11, /* Anything else */
+} avdecode_token_type;
+
+_Static_assert( (int)AVD_UNKNOWN == (int)AVS_TOKEN_UNKNOWN, "decoder tokens must match the counted tokens" );
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : classify_avdecode_token
+// Description  : classify a (whitespace delimited) word the way the scanner
+//                does: a rule must match the whole word (otherwise the 
+//                catch all rule is longer) and the first rule wins a tie
+//
+// Inputs       : s - the start of the word
+//                len - the length of the word
+// Outputs      : the token type
+*/
+
+static avdecode_token_type classify_avdecode_token( const char *s, size_t len ) {
+
+	/* Local variables */
+	size_t i, n;
+
+	/* Station, time and correction only come in one length each */
+	switch ( len ) {
+
+	case 3: /* Correction */
+		if ( memcmp(s, "COR", 3) == 0 ) {
+			return( AVD_CORRECTION );
+		}
+		break;
+
+	case 4: /* Station (takes precedence over a condition pair) */
+		if ( AVD_UPPER(s[0]) && AVD_UPPER(s[1]) && AVD_UPPER(s[2]) && AVD_UPPER(s[3]) ) {
+			return( AVD_AIRPORT );
+		}
+		break;
+
+	case 7: /* Zulu time */
+		if ( AVD_DIGIT(s[0]) && AVD_DIGIT(s[1]) && AVD_DIGIT(s[2]) && 
+			 AVD_DIGIT(s[3]) && AVD_DIGIT(s[4]) ) {
+			if ( AVD_DIGIT(s[5]) && (s[6] == 'Z') ) {
+				return( AVD_ZULUTIME );
+			}
+		}
+		break;
+	}
+
+	/* Visibility, [0-9]{1,2}(/[0-9])?(SM|NM) */
+	if ( (len >= 3) && (len <= 6) && AVD_DIGIT(s[0]) ) {
+		i = AVD_DIGIT(s[1]) ? 2 : 1;
+		if ( (s[i] == '/') && (i + 1 < len) && AVD_DIGIT(s[i+1]) ) {
+			i += 2;
+		}
+		if ( (len == i + 2) && ((s[i] == 'S') || (s[i] == 'N')) && (s[i+1] == 'M') ) {
+			return( AVD_VISIBILITY );
+		}
+	}
+
+	/* Wind, [0-9]{5}KT or [0-9]{5}G[0-9]{2}KT */
+	if ( ((len == 7) || (len == 10)) && AVD_DIGIT(s[0]) && AVD_DIGIT(s[1]) && 
+		 AVD_DIGIT(s[2]) && AVD_DIGIT(s[3]) && AVD_DIGIT(s[4]) && 
+		 (s[len-2] == 'K') && (s[len-1] == 'T') ) {
+		if ( len == 7 ) {
+			return( AVD_WIND );
+		}
+		if ( (s[5] == 'G') && AVD_DIGIT(s[6]) && AVD_DIGIT(s[7]) ) {
+			return( AVD_WINDGUST );
+		}
+	}
+
+	/* Conditions, [-+]? and one to four two letter codes */
+	i = ((s[0] == '+') || (s[0] == '-')) ? 1 : 0;
+	n = len - i;
+	if ( (n >= 2) && (n <= 8) && ((n & 1) == 0) ) {
+		while ( (i < len) && (AVR_CONDITION_LOOKUP(s[i], s[i+1]) != AVR_CONDITION_UN) ) {
+			i += 2;
+		}
+		if ( i == len ) {
+			return( AVD_CONDITION );
+		}
+	}
+
+	/* Coverage, SKC/CLR or (FEW|SCT|BKN|OVC)[0-9]{3} */
+	if ( (len == 3) && ((memcmp(s, "SKC", 3) == 0) || (memcmp(s, "CLR", 3) == 0)) ) {
+		return( AVD_COVERAGE );
+	}
+	if ( (len == 6) && AVD_DIGIT(s[3]) && AVD_DIGIT(s[4]) && AVD_DIGIT(s[5]) &&
+		 ((memcmp(s, "FEW", 3) == 0) || (memcmp(s, "SCT", 3) == 0) || 
+		  (memcmp(s, "BKN", 3) == 0) || (memcmp(s, "OVC", 3) == 0)) ) {
+		return( AVD_COVERAGE );
+	}
+
+	/* Temperature, M?[0-9]{2}/M?[0-9]{2} */
+	if ( (len >= 5) && (len <= 7) ) {
+		i = (s[0] == 'M') ? 1 : 0;
+		if ( AVD_DIGIT(s[i]) && AVD_DIGIT(s[i+1]) && (s[i+2] == '/') ) {
+			i += 3;
+			i += (s[i] == 'M') ? 1 : 0;
+			if ( (len == i + 2) && AVD_DIGIT(s[i]) && AVD_DIGIT(s[i+1]) ) {
+				return( AVD_TEMPERATURE );
+			}
+		}
+	}
+
+	/* Altimeter, A[0-9]{4} */
+	if ( (len == 5) && (s[0] == 'A') && AVD_DIGIT(s[1]) && AVD_DIGIT(s[2]) && 
+		 AVD_DIGIT(s[3]) && AVD_DIGIT(s[4]) ) {
+		return( AVD_ALTIMETER );
+	}
+
+	/* Not a recognized token */
+	return( AVD_UNKNOWN );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : next_avdecode_token
+// Description  : get the next token of a line (a view into the line)
+//
+// Inputs       : stats - the statistics of the parse
+//                pos - the current position in the line (updated)
+//                end - the end of the line
+//                tok - the token to fill in
+// Outputs      : the token type
+*/
+
+static avdecode_token_type next_avdecode_token( avparser_stats *stats, const char **pos, 
+		const char *end, avparser_token *tok ) {
+
+	/* Local variables */
+	const char *ptr = *pos;
+	avdecode_token_type type;
+	AVSTATS_START( stats, start );
+
+	/* Skip white space, newline (or end of the line) is the end of line */
+	while ( (ptr < end) && AVD_SPACE(*ptr) ) {
+		ptr ++;
+	}
+	tok->str = ptr;
+	if ( (ptr == end) || (*ptr == '\n') ) {
+		tok->len = (ptr == end) ? 0 : 1;
+		*pos = ptr + tok->len;
+		type = AVD_EOL;
+	} else {
+
+		/* Find the end of the word, classify it */
+		while ( (ptr < end) && (! AVD_SPACE(*ptr)) && (*ptr != '\n') ) {
+			ptr ++;
+		}
+		tok->len = ptr - tok->str;
+		*pos = ptr;
+		type = classify_avdecode_token( tok->str, tok->len );
+	}
+	AVSTATS_STOP( stats, AVS_TIMER_LEX, start );
+	AVSTATS_COUNT( stats, tokens[type] );
+	return( type );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : decode_avparser_line
+// Description  : decode a single METAR line into a new reading, this follows
+//                the grammar exactly (including creating the reading as soon
+//                as the station and time have been seen), a bad line is 
+//                recorded as an error and skipped (only the fields in 
+//                ctx->fields are decoded, the others are just checked)
+//
+// Inputs       : ctx - the parser context
+//                line - the line to decode (including the newline)
+//                len - the length of the line
+// Outputs      : 0 if successful, -1 if the line is not a valid report
+*/
+
+int decode_avparser_line( avparser_ctx *ctx, const char *line, size_t len ) {
+
+	/* Local variables */
+	const char *pos = line, *end = line + len;
+	avparser_token tok, station, vis, temp, eol;
+	avdecode_token_type type;
+	avreading *avr;
+	int bad;
+	avreading_wind wind;
+	avreading_condition *cond, *conds = NULL, *ctail = NULL;
+	avreading_coverage *cvg, *cvgs = NULL, *vtail = NULL;
+
+	/* Preamble, the reading is created once the station and time are seen */
+	if ( next_avdecode_token(ctx->stats, &pos, end, &station) != AVD_AIRPORT ) {
+		tok = station;
+		goto syntax_error;
+	}
+	if ( next_avdecode_token(ctx->stats, &pos, end, &tok) != AVD_ZULUTIME ) {
+		goto syntax_error;
+	}
+	avr = allocate_avparser_reading( ctx->avout );
+	avr->field = intern_avparser_station( ctx->avout, station );
+	if ( AVSTATS_DECODE(ctx->stats, parse_zulu_time(tok, &avr->rtime, &ctx->timebase)) != 0 ) {
+		add_avparser_error( ctx, AVP_ERROR_TIME, tok );
+	}
+	avr->rcorr = 0;
+	if ( (type = next_avdecode_token(ctx->stats, &pos, end, &tok)) == AVD_CORRECTION ) {
+		avr->rcorr = 1;
+		type = next_avdecode_token(ctx->stats, &pos, end, &tok);
+	}
+
+	/* Wind and visibility */
+	if ( (type != AVD_WIND) && (type != AVD_WINDGUST) ) {
+		goto syntax_error;
+	}
+	memset( &wind, 0x0, sizeof(avreading_wind) );
+	if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_WIND) && 
+		 (AVSTATS_DECODE(ctx->stats, parse_wind(tok, &wind, (type == AVD_WINDGUST) ? AVP_GUST : AVP_NO_GUST)) != 0) ) {
+		add_avparser_error( ctx, AVP_ERROR_WIND, tok );
+	}
+	if ( next_avdecode_token(ctx->stats, &pos, end, &vis) != AVD_VISIBILITY ) {
+		tok = vis;
+		goto syntax_error;
+	}
+
+	/* Weather conditions (optional), appended in order */
+	while ( (type = next_avdecode_token(ctx->stats, &pos, end, &tok)) == AVD_CONDITION ) {
+		if ( ! AVR_FIELD_WANTED(ctx, AVR_FIELD_CONDITIONS) ) {
+			continue;
+		}
+		cond = avarena_alloc( &ctx->avout->arena, sizeof(avreading_condition) );
+		if ( AVSTATS_DECODE(ctx->stats, parse_conditions(tok, cond)) != 0 ) {
+			add_avparser_error( ctx, AVP_ERROR_CONDITION, tok );
+		}
+		cond->next = NULL;
+		if ( ctail == NULL ) {
+			conds = cond;
+		} else {
+			ctail->next = cond;
+		}
+		ctail = cond;
+	}
+
+	/* Cloud layers (at least one), appended in order */
+	if ( type != AVD_COVERAGE ) {
+		goto syntax_error;
+	}
+	while ( type == AVD_COVERAGE ) {
+		if ( ! AVR_FIELD_WANTED(ctx, AVR_FIELD_COVERAGE) ) {
+			type = next_avdecode_token(ctx->stats, &pos, end, &tok);
+			continue;
+		}
+		cvg = avarena_alloc( &ctx->avout->arena, sizeof(avreading_coverage) );
+		cvg->next = NULL;
+		if ( AVSTATS_DECODE(ctx->stats, parse_coverage(tok, cvg)) != 0 ) {
+			add_avparser_error( ctx, AVP_ERROR_COVERAGE, tok );
+		}
+		if ( vtail == NULL ) {
+			cvgs = cvg;
+		} else {
+			vtail->next = cvg;
+		}
+		vtail = cvg;
+		type = next_avdecode_token(ctx->stats, &pos, end, &tok);
+	}
+
+	/* Temperature, altimeter and the end of the line */
+	if ( type != AVD_TEMPERATURE ) {
+		goto syntax_error;
+	}
+	temp = tok;
+	if ( next_avdecode_token(ctx->stats, &pos, end, &tok) != AVD_ALTIMETER ) {
+		goto syntax_error;
+	}
+	if ( next_avdecode_token(ctx->stats, &pos, end, &eol) != AVD_EOL ) {
+		tok = eol;
+		goto syntax_error;
+	}
+
+	/* Fill in the reading (as the grammar does when the report is complete) */
+	avr->rwind = wind;
+	avr->rcond = conds;
+	avr->rcvrg = cvgs;
+	if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_VISIBILITY) && (AVSTATS_DECODE(ctx->stats, parse_visibility(vis, &avr->rviz)) != 0) ) {
+		add_avparser_error( ctx, AVP_ERROR_VISIBILITY, vis );
+	}
+	if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_TEMPERATURE) && (AVSTATS_DECODE(ctx->stats, parse_temperature(temp, &avr->rtemp)) != 0) ) {
+		add_avparser_error( ctx, AVP_ERROR_TEMPERATURE, temp );
+	}
+	if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_ALTIMETER) && (AVSTATS_DECODE(ctx->stats, parse_altimeter(tok, &avr->raltm)) != 0) ) {
+		add_avparser_error( ctx, AVP_ERROR_ALTIMETER, tok );
+	}
+	bad = ctx->badline;
+	complete_avparser_reading( ctx, avr );
+	return( (bad) ? -1 : 0 );
+
+syntax_error:
+	/* Record the offending token (as the grammar does), skip the line */
+	add_avparser_error( ctx, AVP_ERROR_SYNTAX, tok );
+	complete_avparser_reading( ctx, NULL );
+	return( -1 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : decode_avparser_block
+// Description  : decode the lines of the current input block, bad lines are
+//                recorded and skipped (as the grammar recovers from them)
+//
+// Inputs       : ctx - the parser context
+// Outputs      : 0 if successful, -1 if any line was not a valid report
+*/
+
+int decode_avparser_block( avparser_ctx *ctx ) {
+
+	/* Local variables */
+	const char *line = ctx->block, *end = ctx->block + ctx->blen, *eol;
+	int ret = 0;
+
+	/* Walk the lines of the block (each ends with a newline) */
+	while ( line < end ) {
+		eol = memchr( line, '\n', end - line );
+		if ( decode_avparser_line(ctx, line, (eol - line) + 1) != 0 ) {
+			ret = -1;
+		}
+		line = eol + 1;
+	}
+	return( ret );
+}
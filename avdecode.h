@@ -0,0 +1,20 @@
+#ifndef AVDECODE_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avdecode.h
+//  Description   : This file contains the definitions for the hand written
+//                  (single pass) METAR line decoder of the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Thu Nov 21 10:02:44 EST 2019
+*/
+
+/** Include Files **/
+#include <avparse.h>
+
+/** Functional Prototypes **/
+int                   decode_avparser_block( avparser_ctx *ctx );
+int                   decode_avparser_line( avparser_ctx *ctx, const char *line, size_t len );
+
+#define AVDECODE_INCLUDED
+#endif
@@ -0,0 +1,153 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avdedup.c
+//  Description   : This file contains the cache of raw input lines of the 
+//                  avparse library, lines seen before are removed from each 
+//                  input block before it is scanned (feeds re-broadcast the
+//                  same reports many times), see avfilter.c.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Mon Dec  9 14:02:36 EST 2019
+*/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <avparse.h>
+#include <avdedup.h>
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : allocate_avparser_dedup
+// Description  : allocate a cache of input lines (attach to a context with
+//                ctx->dedup, the cache is kept across parses)
+//
+// Inputs       : lines - the number of lines to remember (rounded up)
+// Outputs      : a pointer to the new cache
+*/
+
+avparser_dedup * allocate_avparser_dedup( unsigned int lines ) {
+
+	/* Local variables */
+	avparser_dedup *dedup;
+	unsigned int sets = 1;
+
+	/* Size the cache (a power of 2 sets) */
+	while ( sets * AVPARSE_DEDUP_WAYS < lines ) {
+		sets *= 2;
+	}
+
+	/* Allocate and clear the cache */
+	if ( ((dedup = malloc(sizeof(avparser_dedup))) == NULL) ||
+		 ((dedup->keys = calloc(sets * AVPARSE_DEDUP_WAYS, sizeof(uint64_t))) == NULL) ||
+		 ((dedup->refs = calloc(sets * AVPARSE_DEDUP_WAYS, sizeof(uint8_t))) == NULL) ||
+		 ((dedup->hands = calloc(sets, sizeof(uint8_t))) == NULL) ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	dedup->sets = sets;
+	dedup->hits = dedup->misses = 0;
+	return( dedup );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : release_avparser_dedup
+// Description  : release a cache of input lines
+//
+// Inputs       : dedup - the cache to release
+// Outputs      : none
+*/
+
+void release_avparser_dedup( avparser_dedup *dedup ) {
+
+	/* Free the cache and its contents */
+	if ( dedup != NULL ) {
+		free( dedup->keys );
+		free( dedup->refs );
+		free( dedup->hands );
+		free( dedup );
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : hash_avparser_line
+// Description  : hash a line of input (8 bytes at a time)
+//
+// Inputs       : line - the line to hash
+//                len - the length of the line
+// Outputs      : the hash of the line (never 0)
+*/
+
+static uint64_t hash_avparser_line( const char *line, size_t len ) {
+
+	/* Local variables */
+	uint64_t hash = len * 0x9e3779b97f4a7c15ULL, word;
+
+	/* Mix in the whole words, then the remaining bytes */
+	while ( len >= sizeof(uint64_t) ) {
+		memcpy( &word, line, sizeof(uint64_t) );
+		hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+		hash ^= hash >> 29;
+		line += sizeof(uint64_t);
+		len -= sizeof(uint64_t);
+	}
+	word = 0;
+	memcpy( &word, line, len );
+	hash = (hash ^ word) * 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 32;
+	return( (hash == 0) ? 1 : hash );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : check_avparser_dedup
+// Description  : check if a line is in the cache, add it if not (replacing 
+//                the first line of the set the CLOCK finds unreferenced)
+//
+// Inputs       : dedup - the cache of lines
+//                line - the line to check
+//                len - the length of the line (without the newline)
+// Outputs      : 1 if the line was seen before, 0 if not
+*/
+
+int check_avparser_dedup( avparser_dedup *dedup, const char *line, size_t len ) {
+
+	/* Local variables */
+	uint64_t key = hash_avparser_line( line, len );
+	unsigned int set = (unsigned int)(key & (dedup->sets - 1)), base, way, hand;
+	uint64_t *keys;
+	uint8_t *refs;
+
+	/* Look for the line in its set */
+	base = set * AVPARSE_DEDUP_WAYS;
+	keys = &dedup->keys[base];
+	refs = &dedup->refs[base];
+	for ( way = 0; way < AVPARSE_DEDUP_WAYS; way ++ ) {
+		if ( keys[way] == key ) {
+			refs[way] = 1;
+			dedup->hits ++;
+			return( 1 );
+		}
+	}
+	dedup->misses ++;
+
+	/* Use an empty way, or advance the hand (clearing references) */
+	for ( way = 0; (way < AVPARSE_DEDUP_WAYS) && (keys[way] != 0); way ++ );
+	if ( way == AVPARSE_DEDUP_WAYS ) {
+		hand = dedup->hands[set];
+		while ( refs[hand] ) {
+			refs[hand] = 0;
+			hand = (hand + 1) % AVPARSE_DEDUP_WAYS;
+		}
+		dedup->hands[set] = (uint8_t)((hand + 1) % AVPARSE_DEDUP_WAYS);
+		way = hand;
+	}
+	keys[way] = key;
+	refs[way] = 0;
+	return( 0 );
+}
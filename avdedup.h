@@ -0,0 +1,37 @@
+#ifndef AVDEDUP_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avdedup.h
+//  Description   : This file contains the definitions for the cache of raw
+//                  input lines used to skip repeated reports in the avparse
+//                  library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Mon Dec  9 14:02:36 EST 2019
+*/
+
+/** Include Files **/
+#include <stdint.h>
+#include <stddef.h>
+#include <avparse.h>
+
+/** Definitions and Types **/
+#define AVPARSE_DEDUP_WAYS 8 /* Lines held in each set of the cache */
+
+/* Cache of the lines seen (set associative, CLOCK replacement in each set) */
+typedef struct avparser_dedup_struct {
+	uint64_t      *keys;   /* The hashes of the lines held (0 is empty) */
+	uint8_t       *refs;   /* The CLOCK reference bits of the lines */
+	uint8_t       *hands;  /* The CLOCK hand of each set */
+	unsigned int   sets;   /* The number of sets (power of 2) */
+	unsigned long  hits;   /* The number of repeated lines skipped */
+	unsigned long  misses; /* The number of lines passed on to parse */
+} avparser_dedup;
+
+/** Functional Prototypes **/
+avparser_dedup *      allocate_avparser_dedup( unsigned int lines );
+void                  release_avparser_dedup( avparser_dedup *dedup );
+int                   check_avparser_dedup( avparser_dedup *dedup, const char *line, size_t len );
+
+#define AVDEDUP_INCLUDED
+#endif
@@ -0,0 +1,289 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avfilter.c
+//  Description   : This file contains the filtering of input blocks of the 
+//                  avparse library, a single pass over the block finds the 
+//                  lines (SSE2 where available) and drops the lines of other
+//                  stations and repeated lines before the block is scanned.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Wed Dec 11 10:15:48 EST 2019
+*/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <avparse.h>
+#include <avfldparse.h>
+#include <avdedup.h>
+#include <avfilter.h>
+
+/* Definitions */
+#define AVP_IS_UPPER(c) (((c) >= 'A') && ((c) <= 'Z'))
+#define AVP_IS_BLANK(c) (((c) == ' ') || ((c) == '\t'))
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : allocate_avparser_station_set
+// Description  : allocate an (empty) set of stations to parse (attach to a 
+//                context with ctx->include)
+//
+// Inputs       : none
+// Outputs      : a pointer to the new set
+*/
+
+avparser_station_set * allocate_avparser_station_set( void ) {
+
+	/* Local variables */
+	avparser_station_set *set;
+
+	/* Allocate and clear the set */
+	if ( (set = malloc(sizeof(avparser_station_set))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	memset( set, 0x0, sizeof(avparser_station_set) );
+	return( set );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : add_avparser_station_set
+// Description  : add a station to a set of stations
+//
+// Inputs       : set - the set of stations
+//                station - the station (4 letter) code
+// Outputs      : 0 if successful, -1 if not a station code
+*/
+
+int add_avparser_station_set( avparser_station_set *set, const char *station ) {
+
+	/* Check the code (as the scanner would match it), then add it */
+	if ( (strlen(station) != AVR_STATION_LEN) || (! AVP_IS_UPPER(station[0])) || 
+		 (! AVP_IS_UPPER(station[1])) || (! AVP_IS_UPPER(station[2])) || (! AVP_IS_UPPER(station[3])) ) {
+		return( -1 );
+	}
+	add_avparser_station_code( set, AVR_STATION_CODE(station) );
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : add_avparser_station_code
+// Description  : add a (packed) station code to a set of stations
+//
+// Inputs       : set - the set of stations
+//                code - the packed station code (not 0)
+// Outputs      : 1 if the code was added, 0 if it was in the set already
+*/
+
+int add_avparser_station_code( avparser_station_set *set, uint32_t code ) {
+
+	/* Local variables */
+	uint32_t *codes;
+	unsigned int size, i;
+
+	/* Grow the set when it would be more than half full (rehash the codes) */
+	if ( (set->count + 1) * 2 > set->size ) {
+		size = (set->size == 0) ? 64 : set->size * 2;
+		if ( (codes = calloc(size, sizeof(uint32_t))) == NULL ) {
+			AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+			exit(-1);
+		}
+		for ( i = 0; i < set->size; i ++ ) {
+			if ( set->codes[i] != 0 ) {
+				codes[find_avparser_station(codes, size, set->codes[i])] = set->codes[i];
+			}
+		}
+		free( set->codes );
+		set->codes = codes;
+		set->size = size;
+	}
+
+	/* Add the code (if not there already) */
+	i = find_avparser_station( set->codes, set->size, code );
+	if ( set->codes[i] == 0 ) {
+		set->codes[i] = code;
+		set->count ++;
+		return( 1 );
+	}
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : release_avparser_station_set
+// Description  : release a set of stations
+//
+// Inputs       : set - the set to release
+// Outputs      : none
+*/
+
+void release_avparser_station_set( avparser_station_set *set ) {
+
+	/* Free the set and its codes */
+	if ( set != NULL ) {
+		free( set->codes );
+		free( set );
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : keep_avparser_line
+// Description  : check if a line should be parsed, the station (the first 
+//                token) must be in the station set and the line not seen
+//                before (if the context has a set, cache)
+//
+// Inputs       : ctx - the parser context
+//                line - the line to check
+//                len - the length of the line (without the newline)
+// Outputs      : 1 if the line should be parsed, 0 if not
+*/
+
+static int keep_avparser_line( avparser_ctx *ctx, const char *line, size_t len ) {
+
+	/* Local variables */
+	avparser_station_set *set = ctx->include;
+	const char *tok = line, *end = line + len;
+
+	/* Drop the lines of other stations (and lines with no station) */
+	if ( set != NULL ) {
+		while ( (tok < end) && AVP_IS_BLANK(*tok) ) {
+			tok ++;
+		}
+		if ( (end - tok <= AVR_STATION_LEN) || (! AVP_IS_BLANK(tok[AVR_STATION_LEN])) || 
+			 (set->size == 0) ||
+			 (set->codes[find_avparser_station(set->codes, set->size, AVR_STATION_CODE(tok))] == 0) ) {
+			set->dropped ++;
+			return( 0 );
+		}
+		set->kept ++;
+	}
+
+	/* Drop repeated lines */
+	if ( (ctx->dedup != NULL) && check_avparser_dedup(ctx->dedup, line, len) ) {
+		return( 0 );
+	}
+	return( 1 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : add_avparser_skips
+// Description  : record the number of lines dropped before the next line
+//
+// Inputs       : ctx - the parser context
+//                skipped - the number of lines dropped
+// Outputs      : none
+*/
+
+static void add_avparser_skips( avparser_ctx *ctx, unsigned int skipped ) {
+
+	/* Grow the list as needed, add the count */
+	if ( ctx->nskips == ctx->skipsz ) {
+		ctx->skipsz = (ctx->skipsz == 0) ? 1024 : ctx->skipsz * 2;
+		if ( (ctx->skips = realloc(ctx->skips, ctx->skipsz * sizeof(unsigned int))) == NULL ) {
+			AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+			exit(-1);
+		}
+	}
+	ctx->skips[ctx->nskips++] = skipped;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : filter_avparser_line
+// Description  : keep or drop one line of the block being filtered, a line 
+//                kept is moved down to the end of the lines kept so far
+//
+// Inputs       : ctx - the parser context
+//                line - the line (with its newline)
+//                len - the length of the line
+//                out - the end of the lines kept (updated)
+//                skipped - the lines dropped since the last line kept (updated)
+// Outputs      : none
+*/
+
+static void filter_avparser_line( avparser_ctx *ctx, const char *line, size_t len, char **out, unsigned int *skipped ) {
+
+	/* Keep the line (moving it down), or count it as dropped */
+	if ( keep_avparser_line(ctx, line, len - 1) ) {
+		add_avparser_skips( ctx, *skipped );
+		*skipped = 0;
+		if ( *out != line ) {
+			memmove( *out, line, len );
+		}
+		*out += len;
+	} else {
+		(*skipped) ++;
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : filter_avparser_block
+// Description  : drop the lines of the current input block that should not
+//                be parsed, the lines kept are moved up to the end of the 
+//                block (so the input after it stays in place), the lines 
+//                dropped are counted in to the line numbers as the lines are
+//                completed
+//
+// Inputs       : ctx - the parser context (with a station set or cache)
+// Outputs      : none
+*/
+
+void filter_avparser_block( avparser_ctx *ctx ) {
+
+	/* Local variables */
+	char *block = ctx->block, *out = ctx->block;
+	size_t pos = 0, start = 0, eol, kept;
+	unsigned int skipped = 0;
+#if defined(__SSE2__)
+	__m128i nl = _mm_set1_epi8( '\n' );
+	unsigned int mask;
+#endif
+
+	/* Find the lines 16 bytes at a time (any line ends in the bit mask) */
+	ctx->nskips = ctx->nextskip = 0;
+#if defined(__SSE2__)
+	for ( ; pos + sizeof(__m128i) <= ctx->blen; pos += sizeof(__m128i) ) {
+		mask = (unsigned int)_mm_movemask_epi8( _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + pos)), nl) );
+		while ( mask != 0 ) {
+			eol = pos + __builtin_ctz( mask );
+			filter_avparser_line( ctx, block + start, (eol - start) + 1, &out, &skipped );
+			start = eol + 1;
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	/* Find the lines in the rest of the block a byte at a time */
+	for ( ; pos < ctx->blen; pos ++ ) {
+		if ( block[pos] == '\n' ) {
+			filter_avparser_line( ctx, block + start, (pos - start) + 1, &out, &skipped );
+			start = pos + 1;
+		}
+	}
+	add_avparser_skips( ctx, skipped );
+
+	/* Move the lines kept to the end of the block */
+	kept = out - block;
+	if ( kept < ctx->blen ) {
+		memmove( block + ctx->blen - kept, block, kept );
+		ctx->block += ctx->blen - kept;
+		ctx->blen = kept;
+	}
+
+	/* Count the lines dropped before the first line */
+	ctx->line += ctx->skips[ctx->nextskip++];
+	return;
+}
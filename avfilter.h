@@ -0,0 +1,34 @@
+#ifndef AVFILTER_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avfilter.h
+//  Description   : This file contains the definitions for the filtering of
+//                  input blocks (by station, repeated lines) before they are
+//                  scanned in the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Wed Dec 11 10:15:48 EST 2019
+*/
+
+/** Include Files **/
+#include <stdint.h>
+#include <avparse.h>
+
+/* Set of the stations to parse (keyed on the packed station code) */
+typedef struct avparser_station_set_struct {
+	uint32_t      *codes;   /* The packed station codes (0 is an empty slot) */
+	unsigned int   size;    /* The number of slots in the set (power of 2) */
+	unsigned int   count;   /* The number of stations in the set */
+	unsigned long  kept;    /* The number of lines passed on to parse */
+	unsigned long  dropped; /* The number of lines of other stations dropped */
+} avparser_station_set;
+
+/** Functional Prototypes **/
+avparser_station_set * allocate_avparser_station_set( void );
+int                   add_avparser_station_set( avparser_station_set *set, const char *station );
+int                   add_avparser_station_code( avparser_station_set *set, uint32_t code );
+void                  release_avparser_station_set( avparser_station_set *set );
+void                  filter_avparser_block( avparser_ctx *ctx );
+
+#define AVFILTER_INCLUDED
+#endif
@@ -14,6 +14,13 @@
 #include <time.h>
 #include <ctype.h>
 #include <avfldparse.h>
+#include <avpacked.h>
+#include <avseries.h>
+#include <avfilter.h>
+#include <avwriter.h>
+#include <avinput.h>
+#include <avdecode.h>
+#include <avstats.h>
 
 /* Functions */
 
@@ -24,40 +31,59 @@ const char *avr_coverage_strings[] = {
 	"Sky clear", "Few", "Scattered", "Broken", "Overcast", "Uknown"
 };
 
-/* List of weather conditions */
+/* List of error reasons (by error type) */
+const char *avparser_error_strings[] = {
+	"Syntax error", "Bad ZULU time", "Bad wind data", "Bad visibility data",
+	"Bad condition data", "Bad coverage data", "Bad temperature data", 
+	"Bad altimeter data"
+};
+
+/* Weather conditions (code letters, enum name, description), this single list
+   builds both the code to condition and condition to string lookups */
+#define AVR_CONDITION_TABLE(X) \
+	X('V', 'C', VC, "In the vicinity") \
+	X('B', 'C', BC, "Patches") \
+	X('B', 'L', BL, "Blowing") \
+	X('D', 'R', DR, "Low drifting") \
+	X('F', 'Z', FZ, "Freezing") \
+	X('M', 'I', MI, "Shallow") \
+	X('P', 'R', PR, "Partial") \
+	X('S', 'H', SH, "Showers") \
+	X('T', 'S', TS, "Thunderstorm") \
+	X('D', 'Z', DZ, "Drizzle") \
+	X('G', 'R', GR, "Large hail") \
+	X('G', 'S', GS, "Small hail, snow pellets") \
+	X('I', 'C', IC, "Ice crystals") \
+	X('P', 'L', PL, "Ice pellets") \
+	X('R', 'A', RA, "Rain") \
+	X('S', 'G', SG, "Snow grains") \
+	X('S', 'N', SN, "Snow") \
+	X('U', 'P', UP, "Unknown percipitation") \
+	X('B', 'R', BR, "Mist") \
+	X('D', 'U', DU, "Widespread dust") \
+	X('F', 'G', FG, "Fog") \
+	X('F', 'U', FU, "Smoke") \
+	X('H', 'Z', HZ, "Haze") \
+	X('P', 'Y', PY, "Spray") \
+	X('S', 'A', SA, "Sand") \
+	X('V', 'A', VA, "Volcanic ash") \
+	X('D', 'S', DS, "Dust storm") \
+	X('F', 'C', FC, "Funnel cloud") \
+	X('P', 'O', PO, "Dust/sand whirls") \
+	X('S', 'Q', SQ, "Squalls") \
+	X('S', 'S', SS, "Sand storm")
+
+/* List of weather conditions (condition to description, code) */
+#define AVR_CONDITION_STRING(c1, c2, cond, desc) [AVR_CONDITION_##cond] = { desc, #cond },
 const char *avr_condition_strings[AVR_CONDITION_MAX][2] = {
-	{ "Condition is unknown",     "??" },
-    { "In the vicinity",          "VC" },
-    { "Patches",                  "BC" },
-    { "Blowing",                  "BL" },
-    { "Low drifting",             "DR" },
-    { "Freezing",                 "FZ" },
-    { "Shallow",                  "MI" },
-    { "Partial",                  "PR" },
-    { "Showers",                  "SH" },
-    { "Thunderstorm",             "TS" },
-    { "Drizzle",                  "DZ" },
-    { "Large hail",               "GR" },
-    { "Small hail, snow pellets", "GS" },
-    { "Ice crystals",             "IC" },
-    { "Ice pellets",              "PL" },
-    { "Rain",                     "RA" },
-    { "Snow grains",              "SG" },
-    { "Snow",                     "SN" },
-    { "Unknown percipitation",    "UP" },
-    { "Mist",                     "BR" },
-    { "Widespread dust",          "DU" },
-    { "Fog",                      "FG" },
-    { "Smoke",                    "FU" },
-    { "Haze",                     "HZ" },
-    { "Spray",                    "PY" },
-    { "Sand",                     "SA" },
-    { "Volcanic ash",             "VA" },
-    { "Dust storm",               "DS" },
-    { "Funnel cloud",             "FC" },
-    { "Dust/sand whirls",         "PO" },
-    { "Squalls",                  "SQ" },
-    { "Sand storm",               "SS" },
+	[AVR_CONDITION_UN] = { "Condition is unknown", "??" },
+	AVR_CONDITION_TABLE(AVR_CONDITION_STRING)
+};
+
+/* Direct (26x26) lookup of two letter codes to condition (0 is unknown) */
+#define AVR_CONDITION_CODE(c1, c2, cond, desc) [AVR_CONDITION_INDEX(c1, c2)] = AVR_CONDITION_##cond,
+const unsigned char avr_condition_codes[AVR_CONDITION_CODES] = {
+	AVR_CONDITION_TABLE(AVR_CONDITION_CODE)
 };
 
 /****
@@ -79,13 +105,200 @@ const char *avr_condition_strings[AVR_CONDITION_MAX][2] = {
 
 avparser_out * avreading_metar_parse( FILE *in, char *metar ) {
 
-	/* Allocate structure, parse */
-	set_avparser_input( in, metar );
-	avout = allocate_avparser_struct();
-	yyparse();
+	/* Local variables */
+	avparser_ctx *ctx;
+	avparser_out *out;
+
+	/* Parse with a private context, release it when done */
+	ctx = allocate_avparser_ctx();
+	out = avreading_metar_parse_ctx( ctx, in, metar );
+	release_avparser_ctx( ctx );
 
 	/* Return the parsed data */
-	return( avout );
+	return( out );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : parse_avparser_blocks
+// Description  : parse each block of the (already setup) context input with
+//                the context engine, into the output of the context
+//
+// Inputs       : ctx - the parser context to parse with
+// Outputs      : none
+*/
+
+static void parse_avparser_blocks( avparser_ctx *ctx ) {
+
+	/* Parse each block of lines with the engine */
+	ctx->badline = 0;
+	ctx->nskips = ctx->nextskip = 0;
+	while ( next_avparser_block(ctx) ) {
+		AVSTATS_BLOCK( ctx->stats, ctx->blen );
+		if ( (ctx->include != NULL) || (ctx->dedup != NULL) ) {
+			filter_avparser_block( ctx );
+			if ( ctx->blen == 0 ) {
+				continue;
+			}
+		}
+		if ( ctx->engine == AVP_ENGINE_DECODER ) {
+			decode_avparser_block( ctx );
+		} else {
+			scan_avparser_block( ctx );
+			yyparse( ctx->scanner, ctx );
+			clear_avparser_scan( ctx );
+		}
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : parse_avparser_input
+// Description  : parse each block of the (already setup) context input with
+//                the context engine
+//
+// Inputs       : ctx - the parser context to parse with
+// Outputs      : a pointer to the avreading structure
+*/
+
+static avparser_out * parse_avparser_input( avparser_ctx *ctx ) {
+
+	/* Local variables */
+	avparser_out *out;
+
+	/* Allocate structure, parse the blocks into it */
+	refresh_avreading_timebase( &ctx->timebase, time(NULL) );
+	ctx->avout = out = allocate_avparser_struct();
+	out->stations.span = ctx->span;
+	ctx->line = ctx->errors = 0;
+	parse_avparser_blocks( ctx );
+
+	/* Detach the output from the context, return the parsed data */
+	out->no_lines = ctx->line;
+	ctx->avout = NULL;
+	return( out );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avreading_metar_continue
+// Description  : parse more of the (already setup) context input into the
+//                output of an earlier parse, the line numbers, bad line count
+//                and station index carry on (for input that grows, readings
+//                go to the context callback if there is one)
+//
+// Inputs       : ctx - the parser context to parse with
+//                out - the output to add to
+// Outputs      : the number of lines parsed
+*/
+
+long avreading_metar_continue( avparser_ctx *ctx, avparser_out *out ) {
+
+	/* Local variables */
+	long lines = out->no_lines;
+
+	/* Attach the output, parse the blocks into it */
+	refresh_avreading_timebase( &ctx->timebase, time(NULL) );
+	ctx->avout = out;
+	ctx->line = out->no_lines;
+	parse_avparser_blocks( ctx );
+
+	/* Detach the output from the context, return the lines parsed */
+	out->no_lines = ctx->line;
+	ctx->avout = NULL;
+	return( out->no_lines - lines );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avreading_metar_parse_ctx
+// Description  : parse a METAR string into structure using an explicit 
+//                parser context (reentrant, one context per thread)
+//
+// Inputs       : ctx - the parser context to parse with
+//                fl - file handle for metar input (OR)
+//                metar - the string containing the METAR
+// Outputs      : a pointer to the avreading structure
+*/
+
+avparser_out * avreading_metar_parse_ctx( avparser_ctx *ctx, FILE *in, char *metar ) {
+
+	/* Setup the input, then parse it */
+	set_avparser_input( ctx, in, metar );
+	return( parse_avparser_input(ctx) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avreading_metar_parse_region
+// Description  : parse a region of memory holding METARs (one per line, the
+//                region need not be terminated) into structure
+//
+// Inputs       : ctx - the parser context to parse with
+//                data - the start of the region
+//                len - the length of the region
+// Outputs      : a pointer to the avreading structure
+*/
+
+avparser_out * avreading_metar_parse_region( avparser_ctx *ctx, const char *data, size_t len ) {
+
+	/* Setup the input, then parse it */
+	set_avparser_region( ctx, data, len );
+	return( parse_avparser_input(ctx) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avreading_metar_stream
+// Description  : parse METARs, handing each complete reading to a callback
+//                as it is parsed (the reading storage is recycled when the 
+//                callback returns, so memory does not grow with the input),
+//                bad lines are only counted (in ctx->errors), the callback 
+//                can look up the latest reading of any station in ctx->avout
+//
+// Inputs       : ctx - the parser context to parse with
+//                fl - file handle for metar input (OR)
+//                metar - the string containing the METAR
+//                callback - the function to call with each reading
+//                data - the data to pass to the callback
+// Outputs      : the number of readings streamed
+*/
+
+long avreading_metar_stream( avparser_ctx *ctx, FILE *in, char *metar, avparser_callback callback, void *data ) {
+
+	/* Setup the input and callback, then parse */
+	set_avparser_input( ctx, in, metar );
+	ctx->callback = callback;
+	ctx->cbdata = data;
+	ctx->streamed = 0;
+	release_avparser_struct( parse_avparser_input(ctx) );
+
+	/* Detach the callback, return the number of readings */
+	ctx->callback = NULL;
+	ctx->cbdata = NULL;
+	return( ctx->streamed );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avreading_metar_parse_mmap
+// Description  : parse a file of METARs into structure by memory mapping the
+//                file (bulk ingest, the lines are scanned without copying)
+//
+// Inputs       : ctx - the parser context to parse with
+//                path - the path of the file to parse
+// Outputs      : a pointer to the avreading structure, NULL if the file
+//                could not be mapped
+*/
+
+avparser_out * avreading_metar_parse_mmap( avparser_ctx *ctx, const char *path ) {
+
+	/* Map the input, then parse it */
+	if ( map_avparser_input(ctx, path) != 0 ) {
+		return( NULL );
+	}
+	return( parse_avparser_input(ctx) );
 }
 
 /****
@@ -94,6 +307,67 @@ avparser_out * avreading_metar_parse( FILE *in, char *metar ) {
 
 ****/
 
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : allocate_avparser_ctx
+// Description  : allocate/initialize a parser context (and its scanner), the
+//                context uses the grammar engine and decodes all fields 
+//                unless engine, fields are changed
+//
+// Inputs       : none
+// Outputs      : a pointer to the new context 
+*/
+
+avparser_ctx * allocate_avparser_ctx( void ) {
+
+	/* Local variables */
+	avparser_ctx *ctx;
+
+	/* Create structure if allocation successful */
+	if ( (ctx = malloc(sizeof(avparser_ctx))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	memset(ctx, 0x0, sizeof(avparser_ctx));
+	ctx->fields = AVR_FIELD_ALL;
+#ifdef AVPARSE_STATS
+	if ( (ctx->stats = calloc(1, sizeof(avparser_stats))) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	ctx->stats->sample = AVSTATS_SAMPLE;
+#endif
+
+	/* Create the scanner for the context */
+	if ( init_avparser_scanner(ctx) != 0 ) {
+		AVPARSE_FATAL_ERROR("Scanner initialization failed, aborting");
+		exit(-1);
+	}
+
+	/* Return the parser context */
+	return( ctx );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : release_avparser_ctx
+// Description  : releases the parser context (output is not released)
+//
+// Inputs       : ctx - pointer to the parser context
+// Outputs      : none
+*/
+
+void release_avparser_ctx( avparser_ctx *ctx ) {
+
+	/* Release the scanner, input and the context structure */
+	release_avparser_scanner( ctx );
+	release_avparser_input( ctx );
+	free( ctx->skips );
+	free( ctx->stats );
+	free( ctx );
+	return;
+}
+
 /*/////////////////////////////////////////////////////////////////////////////
 //
 // Function     : allocate_avparser_struct
@@ -116,6 +390,8 @@ avparser_out * allocate_avparser_struct( void ) {
 
 	/* Clear and return the parser structure */
 	memset(out, 0x0, sizeof(avparser_out));
+	avarena_init( &out->arena );
+	avarena_init( &out->stations.arena );
 	return( out );
 }
 
@@ -130,16 +406,9 @@ avparser_out * allocate_avparser_struct( void ) {
 
 void release_avparser_struct( avparser_out *avp ) {
 
-	/* Local variables */
-	avreading *ptr, *tmp;
-
-	/* Walk the structure and clean up the contents of readings */
-	ptr = avp->readings;
-	while (ptr != NULL) {
-		tmp = ptr;
-		ptr = ptr->next;
-		release_avparser_reading(tmp);
-	}
+	/* Release the readings (and their contents) and the stations */
+	avarena_release( &avp->arena );
+	avarena_release( &avp->stations.arena );
 
 	/* Release the base structure and return */
 	free( avp );
@@ -149,7 +418,8 @@ void release_avparser_struct( avparser_out *avp ) {
 /*/////////////////////////////////////////////////////////////////////////////
 //
 // Function     : allocate_avparser_reading
-// Description  : allocate/initialize the reading structure
+// Description  : allocate/initialize the reading structure (it is added to
+//                the output when the line is complete)
 //
 // Inputs       : avout - parser output structure
 // Outputs      : a pointer to the new structure 
@@ -160,106 +430,583 @@ avreading *allocate_avparser_reading( avparser_out *avout ) {
 	/* Local variables */
 	avreading *out;
 
-	/* Create structure if allocation successful, zero */
-	if ( (out = malloc(sizeof(avreading))) == NULL ) {
-		AVPARSE_FATAL_ERROR("Memory allocation failed");
-		exit(-1);
-	}
+	/* Create structure from the output arena, zero */
+	out = avarena_alloc( &avout->arena, sizeof(avreading) );
 	memset(out, 0x0, sizeof(avreading));
 
-	/* Place in avparser output stuct, as necessary */
-	if (avout->readings == NULL) {
-		avout->readings = avout->tail = out;
-		avout->no_readings = 1;
+	/* Return the  weather reading structure */
+	return( out );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : complete_avparser_reading
+// Description  : finish a line of input, the reading is added to the output
+//                unless the line was bad (when streaming the reading is 
+//                handed to the callback and the storage for the line, and
+//                any error record, is recycled)
+//
+// Inputs       : ctx - the parser context
+//                avr - the reading of the line (NULL if none)
+// Outputs      : none
+*/
+
+void complete_avparser_reading( avparser_ctx *ctx, avreading *avr ) {
+
+	/* Local variables */
+	avparser_out *avout = ctx->avout;
+
+	/* Move to the next line (past any lines filtered out), drop the 
+	   reading of a bad line */
+	ctx->line ++;
+	if ( ctx->nextskip < ctx->nskips ) {
+		ctx->line += ctx->skips[ctx->nextskip++];
+	}
+	if ( ctx->badline ) {
+		ctx->badline = 0;
+		avr = NULL;
+	}
+	AVSTATS_LINE( ctx->stats, avr != NULL );
+
+	/* Mark the fields not decoded (-p) as missing, they hold the values of
+	   an absent field (no gust, a temperature consistent in both scales),
+	   the time is always decoded */
+	if ( (avr != NULL) && ((ctx->fields | AVR_FIELD_TIME) != AVR_FIELD_ALL) ) {
+		avr->rmissing = AVR_FIELD_ALL & ~(ctx->fields | AVR_FIELD_TIME);
+		if ( avr->rmissing & AVR_FIELD_WIND ) {
+			avr->rwind.gust = -1;
+		}
+		if ( avr->rmissing & AVR_FIELD_TEMPERATURE ) {
+			avr->rtemp.temperature_fahrenheit = (avr->rtemp.temperature_celsisus * 1.8) + 32;
+			avr->rtemp.dewpoint_fahrenheit = (avr->rtemp.dewpoint_celsisus * 1.8) + 32;
+		}
+	}
+
+	/* Keep the station's latest reading (and series) up to date */
+	if ( avr != NULL ) {
+		update_avparser_latest( avout, avr );
+	}
+
+	/* Hand over the reading, then recycle the line (not the stations) */
+	if ( ctx->callback != NULL ) {
+		if ( avr != NULL ) {
+			ctx->callback( avr, ctx->cbdata );
+			ctx->streamed ++;
+			AVSTATS_RESTART( ctx->stats );
+		}
+		avarena_reset( &avout->arena );
+		avout->readings = avout->tail = NULL;
+		avout->errors = avout->etail = NULL;
+		avout->no_readings = avout->no_errors = 0;
+		return;
+	}
+
+	/* Place in avparser output stuct */
+	if ( avr == NULL ) {
+		return;
+	}
+	if ( avout->readings == NULL ) {
+		avout->readings = avout->tail = avr;
 	} else {
-		avout->tail->next = out;
-		avout->tail = out;
-		avout->no_readings ++;
+		avout->tail->next = avr;
+		avout->tail = avr;
 	}
+	avout->no_readings ++;
+	return;
+}
 
-	/* Return the  weather reading structure */
-	return( out );
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : add_avparser_error
+// Description  : record an error for the current line of input, the line is
+//                skipped (only the first error of a line is recorded)
+//
+// Inputs       : ctx - the parser context
+//                type - the type of error
+//                tok - the offending token
+// Outputs      : none
+*/
+
+void add_avparser_error( avparser_ctx *ctx, avparser_error_type type, avparser_token tok ) {
+
+	/* Local variables */
+	avparser_out *avout = ctx->avout;
+	avparser_error *err;
+
+	/* Only the first error of the line is recorded */
+	if ( ctx->badline ) {
+		return;
+	}
+	ctx->badline = 1;
+	ctx->errors ++;
+	AVSTATS_COUNT( ctx->stats, rejected[type] );
+
+	/* Create the error (the token is copied, without any newline) */
+	while ( (tok.len > 0) && (tok.str[tok.len-1] == '\n') ) {
+		tok.len --;
+	}
+	err = avarena_alloc( &avout->arena, sizeof(avparser_error) );
+	err->line = ctx->line + 1;
+	err->type = type;
+	err->token = avarena_alloc( &avout->arena, tok.len + 1 );
+	memcpy( err->token, tok.str, tok.len );
+	err->token[tok.len] = 0x0;
+	err->next = NULL;
+
+	/* Place in avparser output stuct */
+	if ( avout->errors == NULL ) {
+		avout->errors = avout->etail = err;
+	} else {
+		avout->etail->next = err;
+		avout->etail = err;
+	}
+	avout->no_errors ++;
+	return;
 }
 
 /*/////////////////////////////////////////////////////////////////////////////
 //
-// Function     : release_avparser_struct
-// Description  : releases the avparser structure and its contents
+// Function     : find_avparser_station
+// Description  : find the slot for a station code (open addressing)
 //
-// Inputs       : avr - pointer to the reading structure
-// Outputs      : a pointer to the new structure 
+// Inputs       : codes - the station codes of the table
+//                size - the size of the table (power of 2)
+//                code - the packed station code to look for
+// Outputs      : the slot holding the code, or the empty slot for it
 */
 
-void release_avparser_reading( avreading *avr ) {
+unsigned int find_avparser_station( const uint32_t *codes, unsigned int size, uint32_t code ) {
 
 	/* Local variables */
+	uint32_t hash = code * 0x9e3779b1;
+	unsigned int idx = (hash ^ (hash >> 16)) & (size - 1);
 
-	/* Release the base structure and return */
-	free( avr );
+	/* Probe linearly until we find the code or an empty slot */
+	while ( (codes[idx] != 0) && (codes[idx] != code) ) {
+		idx = (idx + 1) & (size - 1);
+	}
+	return( idx );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : intern_avparser_station
+// Description  : get the (single, shared) copy of a station name
+//
+// Inputs       : avout - parser output structure
+//                tok - the station token
+// Outputs      : a pointer to the interned station name
+*/
+
+char * intern_avparser_station( avparser_out *avout, avparser_token tok ) {
+
+	/* Local variables */
+	avparser_stations *tbl = &avout->stations;
+	uint32_t code = AVR_STATION_CODE(tok.str), *codes;
+	unsigned int idx, i, size;
+	char **names, *name;
+	avreading_packed *latest;
+	avreading_series *series;
+
+	/* Grow the table as needed (keep it at most half full) */
+	if ( (tbl->count + 1) * 2 > tbl->size ) {
+		size = (tbl->size == 0) ? AVP_STATION_TABLE_SIZE : tbl->size * 2;
+		codes = avarena_alloc( &tbl->arena, size * sizeof(uint32_t) );
+		names = avarena_alloc( &tbl->arena, size * sizeof(char *) );
+		latest = avarena_alloc( &tbl->arena, size * sizeof(avreading_packed) );
+		series = avarena_alloc( &tbl->arena, size * sizeof(avreading_series) );
+		memset( codes, 0x0, size * sizeof(uint32_t) );
+		memset( latest, 0x0, size * sizeof(avreading_packed) );
+		memset( series, 0x0, size * sizeof(avreading_series) );
+		for ( i = 0; i < tbl->size; i ++ ) {
+			if ( tbl->codes[i] != 0 ) {
+				idx = find_avparser_station( codes, size, tbl->codes[i] );
+				codes[idx] = tbl->codes[i];
+				names[idx] = tbl->names[i];
+				latest[idx] = tbl->latest[i];
+				series[idx] = tbl->series[i];
+			}
+		}
+		tbl->codes = codes;
+		tbl->names = names;
+		tbl->latest = latest;
+		tbl->series = series;
+		tbl->size = size;
+	}
+
+	/* Look for the station, add it if this is the first time seen */
+	idx = find_avparser_station( tbl->codes, tbl->size, code );
+	if ( tbl->codes[idx] == 0 ) {
+		name = avarena_alloc( &tbl->arena, AVR_STATION_LEN + 1 );
+		memcpy( name, tok.str, AVR_STATION_LEN );
+		name[AVR_STATION_LEN] = 0x0;
+		tbl->codes[idx] = code;
+		tbl->names[idx] = name;
+		tbl->count ++;
+	}
+
+	/* Return the interned name */
+	return( tbl->names[idx] );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : store_avparser_latest
+// Description  : keep a reading as the latest of its station if it is newer
+//                (or a correction of the latest reading)
+//
+// Inputs       : tbl - the station table
+//                pkd - the (packed) reading
+// Outputs      : none
+*/
+
+static void store_avparser_latest( avparser_stations *tbl, const avreading_packed *pkd ) {
+
+	/* Local variables */
+	avreading_packed *cur;
+
+	/* Replace an older reading, or the reading a correction is for */
+	cur = &tbl->latest[find_avparser_station(tbl->codes, tbl->size, pkd->station)];
+	if ( (cur->station == 0) || (pkd->zulu > cur->zulu) || 
+		 ((pkd->zulu == cur->zulu) && (pkd->flags & AVR_PACKED_CORRECTED)) ) {
+		*cur = *pkd;
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : update_avparser_latest
+// Description  : update the latest reading (and time series, if kept) of the
+//                station of a reading (these are kept packed, so they survive
+//                the recycling of the readings when streaming)
+//
+// Inputs       : avout - parser output structure
+//                avr - the (interned) reading
+// Outputs      : none
+*/
+
+void update_avparser_latest( avparser_out *avout, avreading *avr ) {
+
+	/* Local variables */
+	avreading_packed pkd;
+
+	/* Pack the reading (a truncated record is still kept) */
+	pack_avreading( avr, &pkd );
+	if ( pkd.station != 0 ) {
+		store_avparser_latest( &avout->stations, &pkd );
+		if ( avout->stations.span != 0 ) {
+			store_avreading_series( &avout->stations, &pkd );
+		}
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : find_avparser_latest
+// Description  : find the latest reading of a station
+//
+// Inputs       : avout - parser output structure
+//                station - the station (4 letter) code
+// Outputs      : the latest (packed) reading, NULL if the station is unknown
+*/
+
+const avreading_packed * find_avparser_latest( avparser_out *avout, const char *station ) {
+
+	/* Local variables */
+	avparser_stations *tbl = &avout->stations;
+	unsigned int idx;
+
+	/* Look up the station */
+	if ( (tbl->size == 0) || (strnlen(station, AVR_STATION_LEN + 1) != AVR_STATION_LEN) ) {
+		return( NULL );
+	}
+	idx = find_avparser_station( tbl->codes, tbl->size, AVR_STATION_CODE(station) );
+	return( (tbl->codes[idx] == 0) ? NULL : &tbl->latest[idx] );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : compare_avparser_reading
+// Description  : compare two readings (and their conditions, layers)
+//
+// Inputs       : a - the first reading
+//                b - the second reading
+// Outputs      : 0 if the readings are identical, 1 otherwise
+*/
+
+int compare_avparser_reading( avreading *a, avreading *b ) {
+
+	/* Local variables */
+	avreading_condition *ca = a->rcond, *cb = b->rcond;
+	avreading_coverage *va = a->rcvrg, *vb = b->rcvrg;
+
+	/* Compare the base values of the reading */
+	if ( (strcmp(a->field, b->field) != 0) || (a->rtime.zulu != b->rtime.zulu) ||
+		 (a->rtime.local != b->rtime.local) || (a->rcorr != b->rcorr) ||
+		 (a->rwind.speed != b->rwind.speed) || (a->rwind.direction != b->rwind.direction) ||
+		 (a->rwind.gust != b->rwind.gust) || (a->rviz != b->rviz) ||
+		 (memcmp(&a->rtemp, &b->rtemp, sizeof(avreading_temperature)) != 0) ||
+		 (a->raltm != b->raltm) || (a->rmissing != b->rmissing) ) {
+		return( 1 );
+	}
+
+	/* Compare the weather conditions */
+	while ( (ca != NULL) && (cb != NULL) ) {
+		if ( (ca->intensity != cb->intensity) || 
+			 (memcmp(ca->conditions, cb->conditions, sizeof(ca->conditions)) != 0) ) {
+			return( 1 );
+		}
+		ca = ca->next;
+		cb = cb->next;
+	}
+
+	/* Compare the cloud layers */
+	while ( (va != NULL) && (vb != NULL) ) {
+		if ( (va->coverage != vb->coverage) || (va->altitude != vb->altitude) ) {
+			return( 1 );
+		}
+		va = va->next;
+		vb = vb->next;
+	}
+
+	/* Identical if both lists ended together */
+	return( (ca != cb) || (va != vb) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : append_avparser_struct
+// Description  : append the readings of one parser output to another, the
+//                appended output is released (its memory moves over)
+//
+// Inputs       : avout - parser output structure to append to
+//                from - parser output structure to append (released)
+// Outputs      : none
+*/
+
+void append_avparser_struct( avparser_out *avout, avparser_out *from ) {
+
+	/* Local variables */
+	avreading *avr;
+	avparser_error *err;
+	avparser_token tok;
+	avreading_series *ser;
+	avreading_packed pkd;
+	unsigned int i, j;
+
+	/* Point the readings at the stations of the (joined) output */
+	tok.len = AVR_STATION_LEN;
+	for ( avr = from->readings; avr != NULL; avr = avr->next ) {
+		tok.str = avr->field;
+		avr->field = intern_avparser_station( avout, tok );
+	}
+
+	/* Merge the latest readings of the stations */
+	for ( i = 0; i < from->stations.size; i ++ ) {
+		if ( from->stations.latest[i].station != 0 ) {
+			store_avparser_latest( &avout->stations, &from->stations.latest[i] );
+		}
+	}
+
+	/* Merge the time series (or add the readings if the series were not kept) */
+	if ( (avout->stations.span != 0) && (from->stations.span != 0) ) {
+		for ( i = 0; i < from->stations.size; i ++ ) {
+			ser = &from->stations.series[i];
+			for ( j = 0; j < ser->count; j ++ ) {
+				store_avreading_series( &avout->stations, AVR_SERIES_AT(ser, from->stations.span, j) );
+			}
+		}
+	} else if ( avout->stations.span != 0 ) {
+		for ( avr = from->readings; avr != NULL; avr = avr->next ) {
+			pack_avreading( avr, &pkd );
+			if ( pkd.station != 0 ) {
+				store_avreading_series( &avout->stations, &pkd );
+			}
+		}
+	}
+
+	/* Link the errors on to the end of the list (numbering the lines on) */
+	for ( err = from->errors; err != NULL; err = err->next ) {
+		err->line += avout->no_lines;
+	}
+	if ( from->errors != NULL ) {
+		if ( avout->errors == NULL ) {
+			avout->errors = from->errors;
+		} else {
+			avout->etail->next = from->errors;
+		}
+		avout->etail = from->etail;
+		avout->no_errors += from->no_errors;
+	}
+	avout->no_lines += from->no_lines;
+
+	/* Link the readings on to the end of the list */
+	if ( from->readings != NULL ) {
+		if ( avout->readings == NULL ) {
+			avout->readings = from->readings;
+		} else {
+			avout->tail->next = from->readings;
+		}
+		avout->tail = from->tail;
+		avout->no_readings += from->no_readings;
+	}
+
+	/* Take the memory, release the (now empty) structure */
+	avarena_merge( &avout->arena, &from->arena );
+	avarena_merge( &avout->stations.arena, &from->stations.arena );
+	release_avparser_struct( from );
 	return;
 }
 
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : compare_avparser_struct
+// Description  : compare the readings (and errors) of two parser outputs,
+//                reporting each of the differences found
+//
+// Inputs       : a - the first parser output
+//                b - the second parser output
+//                rpt - the file to report differences to
+// Outputs      : the number of readings and errors that differ
+*/
+
+int compare_avparser_struct( avparser_out *a, avparser_out *b, FILE *rpt ) {
+
+	/* Local variables */
+	avreading *ra = a->readings, *rb = b->readings;
+	avparser_error *ea = a->errors, *eb = b->errors;
+	int lineno = 0, diffs = 0;
+	char *sa, *sb;
+
+	/* Walk the readings in order, report the ones that differ */
+	while ( (ra != NULL) && (rb != NULL) ) {
+		if ( compare_avparser_reading(ra, rb) != 0 ) {
+			sa = avreading_to_string( ra, 2 );
+			sb = avreading_to_string( rb, 2 );
+			fprintf( rpt, "Reading %d differs:\n%s%s", lineno, sa, sb );
+			free( sa );
+			free( sb );
+			diffs ++;
+		}
+		ra = ra->next;
+		rb = rb->next;
+		lineno ++;
+	}
+
+	/* Any readings left over in either list are differences too */
+	if ( a->no_readings != b->no_readings ) {
+		fprintf( rpt, "Reading counts differ (%d and %d)\n", a->no_readings, b->no_readings );
+		diffs += abs( a->no_readings - b->no_readings );
+	}
+
+	/* Walk the errors in order, report the ones that differ */
+	while ( (ea != NULL) && (eb != NULL) ) {
+		if ( (ea->line != eb->line) || (ea->type != eb->type) || (strcmp(ea->token, eb->token) != 0) ) {
+			fprintf( rpt, "Error differs: line %ld, %s [%s] and line %ld, %s [%s]\n", 
+				ea->line, avparser_error_strings[ea->type], ea->token, 
+				eb->line, avparser_error_strings[eb->type], eb->token );
+			diffs ++;
+		}
+		ea = ea->next;
+		eb = eb->next;
+	}
+	if ( a->no_errors != b->no_errors ) {
+		fprintf( rpt, "Error counts differ (%d and %d)\n", a->no_errors, b->no_errors );
+		diffs += abs( a->no_errors - b->no_errors );
+	}
+
+	/* Return the number of differences */
+	return( diffs );
+}
+
 /****
 
 	Parsing Functions 
 
 ****/
 
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : refresh_avreading_timebase
+// Description  : compute the time base (current month, UTC offset) used to
+//                convert report times, long running programs should call
+//                this periodically (it is refreshed for each parse call)
+//
+// Inputs       : tb - the time base to refresh
+//                now - the current time
+// Outputs      : none
+*/
+
+void refresh_avreading_timebase( avreading_timebase *tb, time_t now ) {
+
+	/* Local variables */
+	static const int mdays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	struct tm utc, ltm;
+	int pmon, pyear, pdays;
+
+	/* Get the UTC date and the local offset (the only libc time calls) */
+	gmtime_r( &now, &utc );
+	localtime_r( &now, &ltm );
+	tb->now = now;
+	tb->mday = utc.tm_mday;
+	tb->gmtoff = ltm.tm_gmtoff;
+
+	/* Find the start of this month, and the previous one */
+	tb->month = now - (((utc.tm_mday - 1) * 86400) + (utc.tm_hour * 3600) + 
+		(utc.tm_min * 60) + utc.tm_sec);
+	pmon = (utc.tm_mon + 11) % 12;
+	pyear = utc.tm_year + 1900 - ((utc.tm_mon == 0) ? 1 : 0);
+	pdays = mdays[pmon] + ((pmon == 1) && (((pyear % 4 == 0) && (pyear % 100 != 0)) || (pyear % 400 == 0)));
+	tb->prev_month = tb->month - (pdays * 86400);
+	return;
+}
+
 /*/////////////////////////////////////////////////////////////////////////////
 //
 // Function     : parse_zulu_time
-// Description  : parse the zulu time from the metar reading
+// Description  : parse the zulu time from the metar reading, reports are in
+//                the current (UTC) month, unless the day is later than today
+//                (in which case the report is from the previous month, and
+//                the day must be one of that month)
 //
-// Inputs       : tstr - the string containing the time data
+// Inputs       : tok - the token containing the time data
 //              : avt - the time structure to read into
-// Outputs      : the time (converted to local time)
+//              : tb - the time base to convert with
+// Outputs      : 0 if successful, -1 if the data is bad
 */
 
-time_t parse_zulu_time( char *tstr, avreading_time *avt ) {
+int parse_zulu_time( avparser_token tok, avreading_time *avt, avreading_timebase *tb ) {
 
 	/* Local variables */
+	const char *tstr = tok.str;
 	int day, hr, mn;
-	char tempstr[128];
-	struct tm *ltime, adjtime;
-	time_t now;
-
-	/* Scan out the data */
-	if ( sscanf(tstr, "%2d%2d%2dZ", &day, &hr, &mn) != 3 ) {
-		snprintf(tempstr, 128, "Bad ZULU time in aviation data [%s]", tstr);
-		AVPARSE_FATAL_ERROR(tempstr);
-		exit(-1);
+	time_t base = tb->month;
+
+	/* Decode the fixed width data (DDHHMMZ), check the ranges */
+	if ( (tok.len != 7) || !AVP_ISDIGITS2(tstr) || !AVP_ISDIGITS4(tstr+2) || (tstr[6] != 'Z') ) {
+		return( -1 );
+	}
+	day = AVP_DIGITS2(tstr);
+	hr = AVP_DIGITS2(tstr+2);
+	mn = AVP_DIGITS2(tstr+4);
+	if ( (day < 1) || (day > 31) || (hr > 23) || (mn > 59) ) {
+		return( -1 );
 	}
 
-	/* Get the local time, find the offset */
-	now = time(NULL);
-	ltime = localtime(&now);
-	printf( "The local offset is %ld [%s], zulu time = %s\n.", ltime->tm_gmtoff, ltime->tm_zone, tstr );
-
-	/* Setup time to adjust */
-	memset(&adjtime, 0x0, sizeof(adjtime));
-	adjtime.tm_sec = 0;
-	adjtime.tm_min = mn;
-	adjtime.tm_hour = hr;
-	adjtime.tm_mday = day;
-	adjtime.tm_year = ltime->tm_year;
-	adjtime.tm_mon = ltime->tm_mon;
-
-	/* Check to see if month and/or year rolled over */
-	if ( (day != ltime->tm_mday) && (day < ltime->tm_mday) ) {
-		adjtime.tm_mon = ltime->tm_mon + 1;
-		if ( ltime->tm_year == 12 ) {
-			adjtime.tm_year = ltime->tm_year + 1;
+	/* A day later than today is of the previous month (if it has the day) */
+	if ( day > tb->mday ) {
+		if ( day > (tb->month - tb->prev_month) / 86400 ) {
+			return( -1 );
 		}
+		base = tb->prev_month;
 	}
 
-	avt->zulu = mktime(&adjtime);
-	avt->local = avt->zulu + ltime->tm_gmtoff;
-	printf( "The adjusted Zulu time is %s\n", ctime(&avt->zulu));
-
-
-/* https://www.gnu.org/software/libc/manual/html_node/Broken_002ddown-Time.html */
-
-	return( avt->zulu );
+	/* Convert arithmetically from the start of the month of the report */
+	avt->zulu = base + ((day - 1) * 86400) + (hr * 3600) + (mn * 60);
+	avt->local = avt->zulu + tb->gmtoff;
+	return( 0 );
 }
 
 /*/////////////////////////////////////////////////////////////////////////////
@@ -267,35 +1014,28 @@ time_t parse_zulu_time( char *tstr, avreading_time *avt ) {
 // Function     : parse_wind
 // Description  : parse the wind information from the metar reading
 //
-// Inputs       : tstr - the string containing the time data
+// Inputs       : tok - the token containing the wind data
 //              : avw - the wind structure to read from
 //              : gust - flag indicating gust information included
-// Outputs      : the current wind direction
+// Outputs      : 0 if successful, -1 if the data is bad
 */
 
-int parse_wind( char *tstr, avreading_wind *avw, int gust ) {
+int parse_wind( avparser_token tok, avreading_wind *avw, int gust ) {
 
 	/* Local variables */
-	char tempstr[128];
-
-	/* Scan out the data */
-	if ( !gust ) {
-		if ( sscanf(tstr, "%3d%2dKT", &avw->direction, &avw->speed) != 2 ) {
-			snprintf(tempstr, 128, "Bad wind data in aviation data [%s]", tstr);
-			AVPARSE_FATAL_ERROR(tempstr);
-			exit(-1);
-		}
-		avw->gust = -1;
-	} else {
-		if ( sscanf(tstr, "%3d%2dG%2dKT", &avw->direction, &avw->speed, &avw->gust) != 3 ) {
-			snprintf(tempstr, 128, "Bad wind data in aviation data [%s]", tstr);
-			AVPARSE_FATAL_ERROR(tempstr);
-			exit(-1);
-		}
+	const char *tstr = tok.str;
+
+	/* Check the fixed width layout (dddssKT or dddssGggKT) */
+	if ( (tok.len != (gust ? 10 : 7)) || !AVP_ISDIGITS3(tstr) || !AVP_ISDIGITS2(tstr+3) ||
+		 (gust && ((tstr[5] != 'G') || !AVP_ISDIGITS2(tstr+6))) ) {
+		return( -1 );
 	}
 
-	/* Return the wind speed */
-	return( avw->direction );
+	/* Decode the data */
+	avw->direction = AVP_DIGITS3(tstr);
+	avw->speed = AVP_DIGITS2(tstr+3);
+	avw->gust = (gust) ? AVP_DIGITS2(tstr+6) : -1;
+	return( 0 );
 }
 
 /*/////////////////////////////////////////////////////////////////////////////
@@ -303,25 +1043,25 @@ int parse_wind( char *tstr, avreading_wind *avw, int gust ) {
 // Function     : parse_visibility
 // Description  : parse the visibillity
 //
-// Inputs       : tstr - the string containing the time data
-// Outputs      : the visibility in statue miles
+// Inputs       : tok - the token containing the visibility data
+//                vis - the visibility in statue miles (returned)
+// Outputs      : 0 if successful, -1 if the data is bad
 */
 
-int parse_visibility( char *tstr ) {
+int parse_visibility( avparser_token tok, unsigned int *vis ) {
 
 	/* Local variables */
-	char tempstr[128];
-	int vis;
+	const char *tstr = tok.str;
 
-	/* Scan out the data */
-	if ( sscanf(tstr, "%dSM", &vis) != 1 ) {
-		snprintf(tempstr, 128, "Bad visibility data in aviation data [%s]", tstr);
-		AVPARSE_FATAL_ERROR(tempstr);
-		exit(-1);
+	/* Decode the (one or two digit) whole miles, fractions are dropped */
+	if ( (tok.len < 1) || !AVP_ISDIGIT(tstr[0]) ) {
+		return( -1 );
 	}
-
-	/* Return the visibility */
-	return( vis );
+	*vis = AVP_DIGIT(tstr[0]);
+	if ( (tok.len > 1) && AVP_ISDIGIT(tstr[1]) ) {
+		*vis = AVP_DIGITS2(tstr);
+	}
+	return( 0 );
 }
 
 /*/////////////////////////////////////////////////////////////////////////////
@@ -329,18 +1069,20 @@ int parse_visibility( char *tstr ) {
 // Function     : parse_conditions
 // Description  : parse the weather conditions information from a textual data
 //
-// Inputs       : cstr - the string containing the condition data
-// Outputs      : pointer to coverage information
+// Inputs       : tok - the token containing the condition data
+//                conds - the condition structure to read into
+// Outputs      : 0 if successful, -1 if the data is bad
 */
 
-avreading_condition * parse_conditions( char *cstr, avreading_condition *conds ) {
+int parse_conditions( avparser_token tok, avreading_condition *conds ) {
 
 	/* Local variables */
-	char condstr[3] = { 0x0, 0x0, 0x0 }, tempstr[128];
-	int idx = 0, cindex = 0, condnum;
+	char condstr[3] = { 0x0, 0x0, 0x0 };
+	const char *cstr = tok.str;
+	int idx = 0, cindex = 0, len = (int)tok.len;
 
 	/* Zero structure */
-	memset( conds, 0x0, sizeof(avreading_coverage) );
+	memset( conds, 0x0, sizeof(avreading_condition) );
 
 	/* Read the possible intesity */
 	if ( cstr[idx] == '+' ) {
@@ -352,13 +1094,11 @@ avreading_condition * parse_conditions( char *cstr, avreading_condition *conds )
 	}
 
 	/* Keep walking the entire string */
-	while ( (cindex < AVR_MAX_CONDS) && (cstr[idx] != 0x0) ) {
+	while ( (cindex < AVR_MAX_CONDS) && (idx < len) ) {
 
 		/* Sanity check the rest of the string */
-		if ( strlen(&cstr[idx]) < 2 ) {
-			snprintf(tempstr, 128, "Bad condition data in aviation data [%s]", cstr);
-			AVPARSE_FATAL_ERROR(tempstr);
-			exit(-1);			
+		if ( len - idx < 2 ) {
+			return( -1 );
 		}
 
 		/* Setup the string, search conditions */
@@ -367,40 +1107,23 @@ avreading_condition * parse_conditions( char *cstr, avreading_condition *conds )
 		condstr[1] = toupper(cstr[idx]); 
 		idx ++;
 
-		/* Walk all of the known conditions and check to see if it looks good */
-		condnum = AVR_CONDITION_VC;
-		while ( (conds->conditions[cindex] == AVR_CONDITION_UN) && 
-				(condnum < AVR_CONDITION_MAX) ) {
-
-			/* Is this the correct condition */
-			if ( strncmp(condstr, avr_condition_strings[condnum][1], 2) == 0 ) {
-				conds->conditions[cindex] = condnum;
-			} else {
-				condnum ++;
-			}
-
-		}
+		/* Look up the condition (direct table, unknown if not found) */
+		conds->conditions[cindex] = AVR_CONDITION_LOOKUP(condstr[0], condstr[1]);
 
 		/* We did not find the condition */
 		if ( conds->conditions[cindex] == AVR_CONDITION_UN ) {
-			snprintf(tempstr, 128, "Bad condition type in aviation data [%s][%2s]", cstr, condstr);
-			AVPARSE_FATAL_ERROR(tempstr);
-			exit(-1);	
+			return( -1 );
 		}
 
 		/* Move to the next condition */
 		cindex ++;
 	}
 
-	/* Check to make sure we have exhausted the conditions */
-	if ( cstr[idx] != 0x0 ) {
-		snprintf(tempstr, 128, "Too many conditions in aviation data [%s]", cstr);
-		AVPARSE_FATAL_ERROR(tempstr);
-		exit(-1);	
+	/* Check to make sure we have exhausted the conditions (not too many) */
+	if ( idx < len ) {
+		return( -1 );
 	}
-
-	/* Now return the conditions */
-	return( conds );
+	return( 0 );
 }
 
 /*/////////////////////////////////////////////////////////////////////////////
@@ -408,56 +1131,60 @@ avreading_condition * parse_conditions( char *cstr, avreading_condition *conds )
 // Function     : parse_coverage
 // Description  : parse the coverage information from a textual data
 //
-// Inputs       : cstr - the string containing the coverage data
-// Outputs      : pointer to coverage information
+// Inputs       : tok - the token containing the coverage data
+//                coverage - the coverage structure to read into
+// Outputs      : 0 if successful, -1 if the data is bad
 */
 
-avreading_coverage * parse_coverage( char *cstr, avreading_coverage *coverage ) {
+int parse_coverage( avparser_token tok, avreading_coverage *coverage ) {
 
 	/* Local variables */
-	char cvg[4], tempstr[128];
+	const char *cvg = tok.str;
 	int error = 0;
 
-	/* Scan coverage information from data */
-	if ( strlen(cstr) < 6 ) {
-  		error = (sscanf(cstr, "%3s", cvg) != 1) ;	
-    } else {
-    	error = (sscanf(cstr, "%3s%3u", cvg, &coverage->altitude ) != 2);
-	}
-
-    /* If parsed correctly */
-    if ( ! error ) {
-
-	    /* Adjust altitude, process the coverage description */
-	    coverage->altitude *= 100;
-	    if ( strlen(cvg) != 3 ) {
-	    	error = 1;
-	    } else if ( (strncasecmp(cvg, "SKC", 3) == 0) || (strncasecmp(cvg, "CLR", 3) == 0) ) {
-	    	coverage->coverage = AVR_SKYCLEAR;
-	    	coverage->altitude = 0;
-	    } else if ( strncasecmp(cvg, "FEW", 3) == 0 ) {
-	    	coverage->coverage = AVR_FEW;
-	    } else if ( strncasecmp(cvg, "SCT", 3) == 0 ) {
-	    	coverage->coverage = AVR_SCATTERED;
-	    } else if ( strncasecmp(cvg, "BKN", 3) == 0 ) {
-	    	coverage->coverage = AVR_BROKEN;
-	    } else if ( strncasecmp(cvg, "OVC", 3) == 0 ) {
-	    	coverage->coverage = AVR_OVERCAST;
-	    } else {
-	    	error = 1;
-	    }
-
-	}
-
-    /* Check for error, bail out as necessary */
-    if ( error ) {
-		snprintf(tempstr, 128, "Bad coverage data in aviation data [%s]", cstr);
-		AVPARSE_FATAL_ERROR(tempstr);
-		exit(-1);
-    }
+	/* Decode the altitude (hundreds of feet), if the layer has one */
+	if ( tok.len == 3 ) {
+		coverage->altitude = 0;
+	} else if ( (tok.len == 6) && AVP_ISDIGITS3(cvg+3) ) {
+		coverage->altitude = AVP_DIGITS3(cvg+3) * 100;
+	} else {
+		error = 1;
+	}
 
-    /* Return the processed coverage */
-    return( coverage );
+	/* Process the coverage description (dispatch on the first letter) */
+	switch ( cvg[0] ) {
+	case 'S': /* SKC, SCT */
+		if ( memcmp(cvg, "SKC", 3) == 0 ) {
+			coverage->coverage = AVR_SKYCLEAR;
+			coverage->altitude = 0;
+		} else {
+			coverage->coverage = AVR_SCATTERED;
+			error |= (memcmp(cvg, "SCT", 3) != 0);
+		}
+		break;
+	case 'C': /* CLR */
+		coverage->coverage = AVR_SKYCLEAR;
+		coverage->altitude = 0;
+		error |= (memcmp(cvg, "CLR", 3) != 0);
+		break;
+	case 'F': /* FEW */
+		coverage->coverage = AVR_FEW;
+		error |= (memcmp(cvg, "FEW", 3) != 0);
+		break;
+	case 'B': /* BKN */
+		coverage->coverage = AVR_BROKEN;
+		error |= (memcmp(cvg, "BKN", 3) != 0);
+		break;
+	case 'O': /* OVC */
+		coverage->coverage = AVR_OVERCAST;
+		error |= (memcmp(cvg, "OVC", 3) != 0);
+		break;
+	default:
+		error = 1;
+	}
+
+	/* Return the status of the processed coverage */
+	return( (error) ? -1 : 0 );
 }
 
 /*/////////////////////////////////////////////////////////////////////////////
@@ -465,38 +1192,50 @@ avreading_coverage * parse_coverage( char *cstr, avreading_coverage *coverage )
 // Function     : parse_temperature
 // Description  : parse the temperature and dewpoint, converto to F
 //
-// Inputs       : cstr - the string containing the temperature data
+// Inputs       : tok - the token containing the temperature data
 //              : temp - the structure to put the temperature data into
-// Outputs      : the temperature in celsisus
+// Outputs      : 0 if successful, -1 if the data is bad
 */
 
-int parse_temperature( char *cstr, avreading_temperature *temp ) {
+int parse_temperature( avparser_token tok, avreading_temperature *temp ) {
 
 	/* Local variables */
-	char *ptr = cstr;
+	const char *ptr = tok.str, *end = tok.str + tok.len;
+
+	/* Check the layout (M?dd/M?dd) */
+	if ( (tok.len < 5) || (tok.len > 7) ) {
+		return( -1 );
+	}
+	ptr += (ptr[0] == 'M');
+	if ( (end - ptr < 5) || !AVP_ISDIGITS2(ptr) || (ptr[2] != '/') ) {
+		return( -1 );
+	}
+	ptr += 3 + (ptr[3] == 'M');
+	if ( (end - ptr != 2) || !AVP_ISDIGITS2(ptr) ) {
+		return( -1 );
+	}
+	ptr = tok.str;
 
 	/* Read out the temperatiure value */
 	if ( ptr[0] == 'M' ) {
-		temp->temperature_celsisus = -((ptr[1] - '0')*10 + (ptr[2] - '0'));
+		temp->temperature_celsisus = -AVP_DIGITS2(ptr+1);
 		ptr += 4;
 	} else {
-		temp->temperature_celsisus = (ptr[0] - '0')*10 + (ptr[1] - '0');
+		temp->temperature_celsisus = AVP_DIGITS2(ptr);
 		ptr += 3;
 	}
 
 	/* Read out the dew point value */
 	if ( ptr[0] == 'M' ) {
-		temp->dewpoint_celsisus = -((ptr[1] - '0')*10 + (ptr[2] - '0'));
+		temp->dewpoint_celsisus = -AVP_DIGITS2(ptr+1);
 	} else {
-		temp->dewpoint_celsisus = (ptr[0] - '0')*10 + (ptr[1] - '0');
+		temp->dewpoint_celsisus = AVP_DIGITS2(ptr);
 	}
 
 	/* Formula for converstion C to F : (0°C × 9/5) + 32 = 32°F */
 	temp->temperature_fahrenheit = (temp->temperature_celsisus * 1.8) + 32;
 	temp->dewpoint_fahrenheit = (temp->dewpoint_celsisus * 1.8) + 32;
-
-	/* Return the current temperture */
-	return( temp->temperature_celsisus );
+	return( 0 );
 }
 
 /*/////////////////////////////////////////////////////////////////////////////
@@ -504,25 +1243,24 @@ int parse_temperature( char *cstr, avreading_temperature *temp ) {
 // Function     : parse_altimeter
 // Description  : parse the altimeter, convert to inches of mercury
 //
-// Inputs       : astr - the string containing the altimeter data
-// Outputs      : the altimeter reading in inches of mercury
+// Inputs       : tok - the token containing the altimeter data
+//                altm - the altimeter reading in inches of mercury (returned)
+// Outputs      : 0 if successful, -1 if the data is bad
 */
 
-float parse_altimeter( char *astr ) {
+int parse_altimeter( avparser_token tok, float *altm ) {
 
 	/* Local variables */
-	char tempstr[128];
-	int reading;
+	const char *astr = tok.str;
 
-	/* Parse out the altimeter data, return convered value */
-	if ( sscanf(astr, "A%d", &reading) != 1 ) {
-		snprintf(tempstr, 128, "Bad altimeter data in aviation data [%s]", astr);
-		AVPARSE_FATAL_ERROR(tempstr);
-		exit(-1);
+	/* Decode the fixed width altimeter data (Adddd) */
+	if ( (tok.len != 5) || (astr[0] != 'A') || !AVP_ISDIGITS4(astr+1) ) {
+		return( -1 );
 	}
 
 	/* Convert to inches of mercury */
-	return( (float)reading/100.0 );
+	*altm = (float)AVP_DIGITS4(astr+1)/100.0;
+	return( 0 );
 }
 
 /****
@@ -538,98 +1276,18 @@ float parse_altimeter( char *astr ) {
 //
 // Inputs       : avp - pointer to the avparser output
 //                ind - indentation for fields
-// Outputs      : a pointer to the new structure 
+// Outputs      : a pointer to the new string (the caller frees it)
 */
 
 char * avreading_to_string( avreading *avr, int ind ) {
 
 	/* Local variables */
-	char *outstr, tempstr[257], timestr[129];
-	struct tm * tm_info;
-	avreading_condition *condptr;
-	avreading_coverage *coverage;
-
-	/* Add the field/time context */
-	outstr = malloc(1024);
-	memset(outstr, 0x0, 1024);
-	snprintf(tempstr, 256, "READING:\n");
-	safe_strlcat(outstr, tempstr, 1024);
-	snprintf(tempstr, 256, "%*sField: %s\n", ind, "", avr->field);
-	safe_strlcat(outstr, tempstr, 1024);
-
-	/* Now do the time */
-    tm_info = localtime(&avr->rtime.zulu);
-    strftime(timestr, 256, "%r on %A, %B %d %Y", tm_info);
-	snprintf(tempstr, 256, "%*sZulu time: %s\n", ind, "", timestr);
-	safe_strlcat(outstr, tempstr, 1024);
-    tm_info = localtime(&avr->rtime.local);
-    strftime(timestr, 256, "%r on %A, %B %d %Y", tm_info);
-	snprintf(tempstr, 256, "%*sLocal time: %s\n", ind, "", timestr);
-	safe_strlcat(outstr, tempstr, 1024);
-
-	if (avr->rwind.gust != -1) {
-		snprintf(tempstr, 256, "%*sWind %d knots at %d, gusting %d knots\n", ind, "", avr->rwind.speed, avr->rwind.direction, avr->rwind.gust);
-	} else {
-		snprintf(tempstr, 256, "%*sWind %d knots at %d\n", ind, "", avr->rwind.speed, avr->rwind.direction);
-	}
-	safe_strlcat(outstr, tempstr, 1024);
-	snprintf(tempstr, 256, "%*sVisibility: %u statue miles\n", ind, "", avr->rviz);
-	safe_strlcat(outstr, tempstr, 1024);
-
-	/* Process the weather conditions */
-	condptr = avr->rcond;
-	while ( condptr != NULL ) {
-
-		/* Indent the first condition */
-		if ( condptr == avr->rcond ) {	
-			snprintf(tempstr, 256, "%*s", ind, "");
-			safe_strlcat(outstr, tempstr, 1024);
-		} else {
-			safe_strlcat(outstr, "; ", 1024);		
-		}
-
-		/* Encode the condition */
-		tempstr[0] = 0x0;
-		avreading_condition_to_string(condptr, tempstr, 256);
-		safe_strlcat(outstr, tempstr, 1024);
-		if ( condptr->next == NULL ) {
-			safe_strlcat(outstr, "\n", 1024);
-		}
-		condptr = condptr->next;
-	}
- 
-	/* Now do the cloud layers */
-	coverage = avr->rcvrg;
-	while (coverage != NULL) {
-		if ((coverage->coverage < AVR_SKYCLEAR) || (coverage->coverage > AVR_OVERCAST)) {
-			snprintf(tempstr, 256, "%*sCloud layer %s at %d feet\n", ind, "", 
-				avr_coverage_strings[AVR_UNKNOWN], coverage->altitude);
-		} else {
-			if (coverage->coverage == AVR_SKYCLEAR) {
-				snprintf(tempstr, 256, "%*sCloud layer %s\n", ind, "", 
-					avr_coverage_strings[coverage->coverage]);
-			} else {
-				snprintf(tempstr, 256, "%*sCloud layer %s at %d feet\n", ind, "", 
-					avr_coverage_strings[coverage->coverage], coverage->altitude);
-			}
-		}
-		safe_strlcat(outstr, tempstr, 1024);
-		coverage = coverage->next;
-	}
+	avparser_writer *wr;
 
-	/* Temperature, Dewpoint */
-	snprintf(tempstr, 256, "%*sTemperature: %d Celsisus, %d Fahrenheit\n", ind, "", 
-		avr->rtemp.temperature_celsisus, avr->rtemp.temperature_fahrenheit);
-	safe_strlcat(outstr, tempstr, 1024);
-	snprintf(tempstr, 256, "%*sDew point: %d Celsisus, %d, Fahrenheit\n", ind, "", 
-		avr->rtemp.dewpoint_celsisus, avr->rtemp.dewpoint_fahrenheit);
-	safe_strlcat(outstr, tempstr, 1024);
-
-	snprintf(tempstr, 256, "%*sAltimeter setting: %4.2f inches\n", ind, "", avr->raltm);
-	safe_strlcat(outstr, tempstr, 1024);
-
-	/* Return the new string */
-	return(outstr);
+	/* Write the reading into memory, return the text */
+	wr = allocate_avparser_writer( NULL, -1 );
+	write_avreading( wr, avr, ind );
+	return( detach_avparser_writer(wr) );
 }
 
 /*/////////////////////////////////////////////////////////////////////////////
@@ -646,84 +1304,63 @@ char * avreading_to_string( avreading *avr, int ind ) {
 char * avreading_condition_to_string( avreading_condition *cond, char *str, size_t len ) {
 
 	/* Local variables */
-	char tempstr[128];
-	int condidx;
-
-	/* Process the intensity of the condition, if there is one */
-	if ( cond->intensity > AVR_CONDITION_ITENSITY_NONE ) {
-		if ( cond->intensity == AVR_CONDITION_ITENSITY_LIGHT ) {
-			strncpy(str, "Light ", len);
-		} else if ( cond->intensity == AVR_CONDITION_ITENSITY_HEAVY ) {
-			strncpy(str, "Heavy ", len);
-		} else {
-			/* Unknown intensity level, error out */
-			snprintf(tempstr, 128, "Bad intensity value in parsed aviation data [%d]", cond->intensity);
-			AVPARSE_FATAL_ERROR(tempstr);
-			exit(-1);			
-		}
+	avparser_writer wr;
+
+	/* Write the condition (as the text output does) into the string */
+	if ( len == 0 ) {
+		return( str );
 	}
+	fixed_avparser_writer( &wr, str, len );
+	write_avreading_condition( &wr, cond );
+	str[wr.len] = 0x0;
+	return( str );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : print_parsed_errors
+// Description  : print the errors (bad lines) of the parser output
+//
+// Inputs       : avp - pointer to the avparser output
+//                out - the file to print to
+// Outputs      : none
+*/
 
-	/* Now add the conditions */
-	condidx = 0;
-	while ( (condidx < AVR_MAX_CONDS) && (cond->conditions[condidx] != AVR_CONDITION_UN) ) {
+void print_parsed_errors( avparser_out *avp, FILE *out ) {
 
-		/* Check for errored condition */
-		if ( cond->conditions[condidx] >= AVR_CONDITION_MAX ) {
-			/* Unknown intensity level, error out */
-			snprintf(tempstr, 128, "Bad condition value in parsed aviation data [%d]", cond->conditions[condidx]);
-			AVPARSE_FATAL_ERROR(tempstr);
-			exit(-1);					
-		}
+	/* Local variables */
+	avparser_error *err;
 
-		/* Now add the condition, move to next */
-		if ( condidx > 0 ) {
-			safe_strlcat(str, ", ", len-1);
-		}
-		safe_strlcat(str, avr_condition_strings[cond->conditions[condidx]][0], len-1);
-		condidx ++;
+	/* Walk the errors, print out */
+	for ( err = avp->errors; err != NULL; err = err->next ) {
+		fprintf( out, "error: line %ld, %s [%s]\n", err->line, 
+			avparser_error_strings[err->type], err->token );
 	}
-
-	/* EOL, return the string */
-	return( str );
+	return;
 }
 
 /*/////////////////////////////////////////////////////////////////////////////
 //
 // Function     : print_parsed_input
-// Description  : do a simple output of the parser output
+// Description  : do a simple output of the parser output (to stdout)
 //
 // Inputs       : avp - pointer to the avparser output
-// Outputs      : a pointer to the new structure 
+// Outputs      : none
 */
 
 void print_parsed_input( avparser_out *avp ) {
 
 	/* Local variables */
-	char *outstr, *tstr;
-	avreading *ptr;
-	int lineno = 0;
-
-	/* Add the fields */
-	outstr = malloc(4097);
-	memset(outstr, 0x0, 4097);
-
-	/* Walk the readings, convert to string and print out */
-	ptr = avp->readings;
-	while (ptr != NULL) {
-		tstr = avreading_to_string(ptr, 2);
-		safe_strlcat(outstr, tstr, 4096);
-		free(tstr);
-		ptr = ptr->next;
-		lineno ++;
-	}
+	avparser_writer *wr;
 
-	printf( "%s", outstr );
-	free( outstr );
+	/* Write the readings out (as text, in large blocks) */
+	wr = allocate_avparser_writer( stdout, -1 );
+	write_parsed_input( wr, avp );
+	release_avparser_writer( wr );
 
 	/* Return, no return value */
 	return;
 }
-	
 
 /* Utility Functions */
 
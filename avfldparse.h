@@ -16,41 +16,72 @@
 /* Defines */
 #define AVP_NO_GUST 0
 #define AVP_GUST 1
+#define AVP_STATION_TABLE_SIZE 64 /* Initial size of the station table */
+
+/* Fixed width decimal decoders (the scanner has checked the digit layout) */
+#define AVP_ISDIGIT(c)   ((unsigned char)((c) - '0') < 10)
+#define AVP_ISDIGITS2(s) (AVP_ISDIGIT((s)[0]) && AVP_ISDIGIT((s)[1]))
+#define AVP_ISDIGITS3(s) (AVP_ISDIGITS2(s) && AVP_ISDIGIT((s)[2]))
+#define AVP_ISDIGITS4(s) (AVP_ISDIGITS2(s) && AVP_ISDIGITS2((s)+2))
+#define AVP_DIGIT(c)     ((c) - '0')
+#define AVP_DIGITS2(s)   (AVP_DIGIT((s)[0])*10 + AVP_DIGIT((s)[1]))
+#define AVP_DIGITS3(s)   (AVP_DIGITS2(s)*10 + AVP_DIGIT((s)[2]))
+#define AVP_DIGITS4(s)   (AVP_DIGITS2(s)*100 + AVP_DIGITS2((s)+2))
 
 /** Functional Prototypes **/
 
 /* Base Parsing Functions */
 avparser_out * avreading_metar_parse( FILE *in, char *metar );
+avparser_out * avreading_metar_parse_ctx( avparser_ctx *ctx, FILE *in, char *metar );
+avparser_out * avreading_metar_parse_region( avparser_ctx *ctx, const char *data, size_t len );
+avparser_out * avreading_metar_parse_mmap( avparser_ctx *ctx, const char *path );
+long           avreading_metar_stream( avparser_ctx *ctx, FILE *in, char *metar, avparser_callback callback, void *data );
+long           avreading_metar_continue( avparser_ctx *ctx, avparser_out *out );
 
 /* Structure Processing Functions */
+avparser_ctx *        allocate_avparser_ctx( void );
+void                  release_avparser_ctx( avparser_ctx *ctx );
 avparser_out *        allocate_avparser_struct( void );
 void                  release_avparser_struct( avparser_out *avp );
 avreading *           allocate_avparser_reading( avparser_out *avout );
-void                  release_avparser_reading( avreading *avr );
+void                  complete_avparser_reading( avparser_ctx *ctx, avreading *avr );
+void                  add_avparser_error( avparser_ctx *ctx, avparser_error_type type, avparser_token tok );
+char *                intern_avparser_station( avparser_out *avout, avparser_token tok );
+unsigned int          find_avparser_station( const uint32_t *codes, unsigned int size, uint32_t code );
+void                  update_avparser_latest( avparser_out *avout, avreading *avr );
+const struct avreading_packed_struct * find_avparser_latest( avparser_out *avout, const char *station );
+void                  append_avparser_struct( avparser_out *avout, avparser_out *from );
+int                   compare_avparser_reading( avreading *a, avreading *b );
+int                   compare_avparser_struct( avparser_out *a, avparser_out *b, FILE *rpt );
 
 /* Parsing Functions */
-time_t                parse_zulu_time( char *tstr, avreading_time *avt );
-int                   parse_wind( char *tstr, avreading_wind *avw, int gust );
-int                   parse_visibility( char *tstr );
-avreading_coverage *  parse_coverage( char *cstr, avreading_coverage *coverage );
-avreading_condition * parse_conditions( char *cstr, avreading_condition *conds );
-int                   parse_temperature( char *cstr, avreading_temperature *temp );
-float                 parse_altimeter( char *astr );
+void                  refresh_avreading_timebase( avreading_timebase *tb, time_t now );
+int                   parse_zulu_time( avparser_token tok, avreading_time *avt, avreading_timebase *tb );
+int                   parse_wind( avparser_token tok, avreading_wind *avw, int gust );
+int                   parse_visibility( avparser_token tok, unsigned int *vis );
+int                   parse_coverage( avparser_token tok, avreading_coverage *coverage );
+int                   parse_conditions( avparser_token tok, avreading_condition *conds );
+int                   parse_temperature( avparser_token tok, avreading_temperature *temp );
+int                   parse_altimeter( avparser_token tok, float *altm );
 
 /* Output / Debug Functions  */
 char *                avreading_to_string( avreading *avr, int ind );
 char *                avreading_condition_to_string( avreading_condition *cond, char *str, size_t len );
 void                  print_parsed_input( avparser_out *avp );
+void                  print_parsed_errors( avparser_out *avp, FILE *out );
 
 /* Utility Functions */
 size_t                safe_strlcat(char * dst, const char * src, size_t dstsize);
 
 
 /* Lexer/processing bookeeping functions */
-extern void           set_avparser_input( FILE *in, char *metar );
-extern void           yyerror(char *s);
-extern int            yylex(void);
-extern char *         yytext;
+extern int            init_avparser_scanner( avparser_ctx *ctx );
+extern void           release_avparser_scanner( avparser_ctx *ctx );
+extern void           scan_avparser_block( avparser_ctx *ctx );
+extern void           clear_avparser_scan( avparser_ctx *ctx );
+extern int            yyparse( void *scanner, avparser_ctx *ctx );
+extern void           yyerror( void *scanner, avparser_ctx *ctx, const char *s );
+extern int            yydebug;
 
 #define AVFLDPARSE_INCLUDED
 #endif
\ No newline at end of file
@@ -0,0 +1,395 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avfollow.c
+//  Description   : This file contains the code for following a file of METARs
+//                  that is appended to (a feed or spool file), the offset read
+//                  up to and the partial last line are kept between reads so
+//                  only the bytes appended are parsed (growth is waited for
+//                  with inotify where there is one, the size is polled if not).
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Mon Dec 23 09:17:36 EST 2019
+*/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include <avparse.h>
+#include <avfldparse.h>
+#include <avinput.h>
+#include <avfollow.h>
+
+/* Definitions */
+#define AVFOLLOW_EVENTS (IN_MODIFY|IN_ATTRIB|IN_CLOSE_WRITE|IN_MOVE_SELF|IN_DELETE_SELF)
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avfollow_watch
+// Description  : watch the (newly opened) file for changes (if inotify is
+//                available), the watch of any earlier file is removed
+//
+// Inputs       : fl - the followed file
+// Outputs      : none
+*/
+
+static void avfollow_watch( avparser_follow *fl ) {
+
+	/* Replace the watch (none means the size is polled) */
+#ifdef __linux__
+	if ( fl->notify != -1 ) {
+		if ( fl->watch != -1 ) {
+			inotify_rm_watch( fl->notify, fl->watch );
+		}
+		fl->watch = inotify_add_watch( fl->notify, fl->path, AVFOLLOW_EVENTS );
+	}
+#endif
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avfollow_line_start
+// Description  : find the start of the last (partial) line of a file, the
+//                offset just after the last newline
+//
+// Inputs       : file - the file
+//                size - the size of the file
+// Outputs      : the offset of the start of the line
+*/
+
+static off_t avfollow_line_start( FILE *file, off_t size ) {
+
+	/* Local variables */
+	char buf[4096];
+	off_t pos = size;
+	ssize_t len, i;
+
+	/* Read back from the end a buffer at a time, looking for a newline */
+	while ( pos > 0 ) {
+		len = (pos < (off_t)sizeof(buf)) ? pos : (off_t)sizeof(buf);
+		if ( pread(fileno(file), buf, len, pos - len) != len ) {
+			return( size );
+		}
+		for ( i = len; i > 0; i -- ) {
+			if ( buf[i-1] == '\n' ) {
+				return( pos - len + i );
+			}
+		}
+		pos -= len;
+	}
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avfollow_mark
+// Description  : keep the bytes just before the offset read up to (to check
+//                the file was not rewritten before the next read)
+//
+// Inputs       : fl - the followed file
+// Outputs      : none
+*/
+
+static void avfollow_mark( avparser_follow *fl ) {
+
+	/* Local variables */
+	size_t len = (fl->offset < AVFOLLOW_MARK) ? (size_t)fl->offset : AVFOLLOW_MARK;
+
+	/* Read the bytes (none are kept if they cannot be) */
+	fl->marklen = 0;
+	if ( (len > 0) && (pread(fileno(fl->file), fl->mark, len, fl->offset - len) == (ssize_t)len) ) {
+		fl->marklen = len;
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avfollow_rewritten
+// Description  : check if a followed file was truncated since the last read,
+//                as it is smaller than the offset read up to or the bytes
+//                before the offset have changed (it was truncated, then
+//                grown past the offset before the read)
+//
+// Inputs       : fl - the followed file
+//                size - the size of the file
+// Outputs      : 1 if the file was rewritten, 0 if not
+*/
+
+static int avfollow_rewritten( avparser_follow *fl, off_t size ) {
+
+	/* Local variables */
+	char buf[AVFOLLOW_MARK];
+
+	/* Check the size, then the bytes before the offset */
+	if ( size < fl->offset ) {
+		return( 1 );
+	}
+	return( (fl->marklen > 0) && 
+			((pread(fileno(fl->file), buf, fl->marklen, fl->offset - fl->marklen) != (ssize_t)fl->marklen) ||
+			 (memcmp(buf, fl->mark, fl->marklen) != 0)) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avfollow_changed
+// Description  : check if the followed file has changed since it was read
+//                (grown, truncated, replaced or deleted)
+//
+// Inputs       : fl - the followed file
+// Outputs      : 1 if the file changed, 0 if not
+*/
+
+static int avfollow_changed( avparser_follow *fl ) {
+
+	/* Local variables */
+	struct stat st;
+
+	/* Check the size and links of the file, and the file at the path */
+	if ( fl->deleted ) {
+		return( 0 );
+	}
+	if ( (fstat(fileno(fl->file), &st) == 0) && 
+		 ((st.st_size != fl->offset) || (st.st_nlink == 0) || avfollow_rewritten(fl, st.st_size)) ) {
+		return( 1 );
+	}
+	return( (stat(fl->path, &st) == 0) && ((st.st_dev != fl->dev) || (st.st_ino != fl->ino)) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : open_avparser_follow
+// Description  : open a file to follow, the readings of each read are
+//                handed to the callback (or kept in the output if there is
+//                none), the station index of the output is kept throughout
+//
+// Inputs       : ctx - the parser context to parse with (its input and
+//                      callback are used for the file until it is closed)
+//                path - the path of the file to follow
+//                end - flag indicating only lines added from now are parsed
+//                      (the partial last line is completed by them)
+//                callback - the function to call with each reading (or NULL)
+//                data - the data to pass to the callback
+// Outputs      : a pointer to the followed file, NULL if it could not be
+//                opened
+*/
+
+avparser_follow * open_avparser_follow( avparser_ctx *ctx, const char *path, int end, avparser_callback callback, void *data ) {
+
+	/* Local variables */
+	avparser_follow *fl;
+	struct stat st;
+	FILE *file;
+
+	/* Open the file, start at its end (the last line) if requested */
+	if ( (file = fopen(path, "r")) == NULL ) {
+		return( NULL );
+	}
+	if ( (fstat(fileno(file), &st) == -1) ||
+		 (end && (fseeko(file, avfollow_line_start(file, st.st_size), SEEK_SET) != 0)) ) {
+		fclose( file );
+		return( NULL );
+	}
+
+	/* Allocate and setup the followed file */
+	if ( ((fl = malloc(sizeof(avparser_follow))) == NULL) ||
+		 ((fl->path = strdup(path)) == NULL) ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	fl->ctx = ctx;
+	fl->out = allocate_avparser_struct();
+	fl->out->stations.span = ctx->span;
+	fl->file = file;
+	fl->offset = ftello( file );
+	fl->dev = st.st_dev;
+	fl->ino = st.st_ino;
+	fl->notify = fl->watch = -1;
+	fl->truncated = fl->replaced = 0;
+	fl->deleted = 0;
+	avfollow_mark( fl );
+#ifdef __linux__
+	fl->notify = inotify_init1( IN_NONBLOCK|IN_CLOEXEC );
+#endif
+	avfollow_watch( fl );
+
+	/* Dedicate the context input to the file (keeping a partial last line) */
+	set_avparser_input( ctx, file, NULL );
+	ctx->follow = 1;
+	ctx->callback = callback;
+	ctx->cbdata = data;
+	ctx->streamed = 0;
+	ctx->errors = 0;
+	return( fl );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : read_avparser_follow
+// Description  : parse the lines appended to a followed file since the last
+//                read, a partial last line is kept until it is completed, a
+//                truncated (or rewritten) file is read again from the start,
+//                a replaced file (e.g., rotated) is finished then the new file
+//                is read and a deleted file is finished (and flagged deleted,
+//                it is not read again)
+//
+// Inputs       : fl - the followed file
+// Outputs      : the number of lines parsed
+*/
+
+long read_avparser_follow( avparser_follow *fl ) {
+
+	/* Local variables */
+	avparser_ctx *ctx = fl->ctx;
+	struct stat st;
+	FILE *file = NULL;
+	long lines;
+	int keep = 1;
+
+	/* A truncated file is read from the start (the partial line is dropped) */
+	if ( fl->deleted ) {
+		return( 0 );
+	}
+	if ( (fstat(fileno(fl->file), &st) == 0) && avfollow_rewritten(fl, st.st_size) &&
+		 (fseeko(fl->file, 0, SEEK_SET) == 0) ) {
+		fl->truncated ++;
+		keep = 0;
+	}
+
+	/* Parse the bytes appended (completing any partial line) */
+	resume_avparser_input( ctx, keep );
+	lines = avreading_metar_continue( ctx, fl->out );
+	fl->offset = ftello( fl->file );
+	avfollow_mark( fl );
+
+	/* Look for a new file at the path, or none (the file unlinked) */
+	if ( stat(fl->path, &st) == 0 ) {
+		if ( (st.st_dev != fl->dev) || (st.st_ino != fl->ino) ) {
+			file = fopen( fl->path, "r" );
+		}
+	} else if ( (errno == ENOENT) && (fstat(fileno(fl->file), &st) == 0) && (st.st_nlink == 0) ) {
+		fl->deleted = 1;
+	}
+
+	/* Finish a replaced or deleted file (its partial line is its last) */
+	if ( (file != NULL) || fl->deleted ) {
+		ctx->follow = 0;
+		resume_avparser_input( ctx, 1 );
+		lines += avreading_metar_continue( ctx, fl->out );
+		ctx->follow = 1;
+	}
+
+	/* Read the new file */
+	if ( file != NULL ) {
+		fclose( fl->file );
+		fl->file = file;
+		if ( fstat(fileno(file), &st) == 0 ) {
+			fl->dev = st.st_dev;
+			fl->ino = st.st_ino;
+		}
+		avfollow_watch( fl );
+		fl->replaced ++;
+		set_avparser_input( ctx, file, NULL );
+		lines += avreading_metar_continue( ctx, fl->out );
+		fl->offset = ftello( file );
+		avfollow_mark( fl );
+	}
+	return( lines );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : wait_avparser_follow
+// Description  : wait for a followed file to change (with inotify, or by
+//                polling its size), a file replaced at its path may only be
+//                noticed at the timeout (the watch is on the file read), the
+//                size is polled once the watch is gone (the file deleted)
+//
+// Inputs       : fl - the followed file
+//                timeout - the most milliseconds to wait (-1 for no limit)
+// Outputs      : 1 if the file changed, 0 at the timeout, -1 if the wait
+//                failed or was interrupted (errno is set)
+*/
+
+int wait_avparser_follow( avparser_follow *fl, int timeout ) {
+
+	/* Local variables */
+	int waited, ret;
+#ifdef __linux__
+	char events[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *ev;
+	struct pollfd pfd;
+	ssize_t len, pos;
+
+	/* Wait for events on the watch, then drain them (noting the end of the
+	   watch, the file was deleted) */
+	if ( (fl->notify != -1) && (fl->watch != -1) ) {
+		pfd.fd = fl->notify;
+		pfd.events = POLLIN;
+		if ( (ret = poll(&pfd, 1, timeout)) <= 0 ) {
+			return( ret );
+		}
+		while ( (len = read(fl->notify, events, sizeof(events))) > 0 ) {
+			for ( pos = 0; pos < len; pos += sizeof(struct inotify_event) + ev->len ) {
+				ev = (struct inotify_event *)(events + pos);
+				if ( (ev->wd == fl->watch) && (ev->mask & (IN_DELETE_SELF|IN_IGNORED)) ) {
+					fl->watch = -1;
+				}
+			}
+		}
+		return( 1 );
+	}
+#endif
+
+	/* Poll the file until it changes */
+	for ( waited = 0; (timeout < 0) || (waited < timeout); waited += AVFOLLOW_POLL ) {
+		if ( avfollow_changed(fl) ) {
+			return( 1 );
+		}
+		if ( (ret = poll(NULL, 0, AVFOLLOW_POLL)) < 0 ) {
+			return( ret );
+		}
+	}
+	return( avfollow_changed(fl) );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : close_avparser_follow
+// Description  : stop following a file, the context input and callback are
+//                released (a partial last line is not parsed) and the output
+//                is released
+//
+// Inputs       : fl - the followed file
+// Outputs      : none
+*/
+
+void close_avparser_follow( avparser_follow *fl ) {
+
+	/* Detach the file and callback from the context */
+	set_avparser_region( fl->ctx, NULL, 0 );
+	fl->ctx->follow = 0;
+	fl->ctx->callback = NULL;
+	fl->ctx->cbdata = NULL;
+
+	/* Close the file and watch, release the output and structure */
+	fclose( fl->file );
+#ifdef __linux__
+	if ( fl->notify != -1 ) {
+		close( fl->notify );
+	}
+#endif
+	release_avparser_struct( fl->out );
+	free( fl->path );
+	free( fl );
+	return;
+}
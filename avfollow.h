@@ -0,0 +1,48 @@
+#ifndef AVFOLLOW_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avfollow.h
+//  Description   : This file contains the definitions for following a file of
+//                  METARs that is appended to (a feed or spool file), only the
+//                  bytes appended since the last read are parsed.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Mon Dec 23 09:17:36 EST 2019
+*/
+
+/** Include Files **/
+#include <stdio.h>
+#include <sys/types.h>
+#include <avparse.h>
+
+/** Definitions and Types **/
+#define AVFOLLOW_POLL 250 /* Milliseconds between size checks (no inotify) */
+#define AVFOLLOW_MARK 64  /* Bytes before the offset kept (to notice a rewrite) */
+
+/* A file being followed, the context input is dedicated to the file (the
+   partial line at the end of the file is kept in the context buffer) */
+typedef struct avparser_follow_struct {
+	avparser_ctx  *ctx;       /* The parser context the file is parsed with */
+	avparser_out  *out;       /* The output (station index, and readings if not streamed) */
+	char          *path;      /* The path of the file followed */
+	FILE          *file;      /* The file being read */
+	off_t          offset;    /* The offset in the file read up to */
+	char           mark[AVFOLLOW_MARK]; /* The bytes just before the offset */
+	size_t         marklen;   /* The number of bytes in mark */
+	dev_t          dev;       /* The device of the file (to notice it being replaced) */
+	ino_t          ino;       /* The inode of the file */
+	int            notify;    /* The inotify descriptor (-1 if the size is polled) */
+	int            watch;     /* The inotify watch of the file (-1 if none) */
+	unsigned long  truncated; /* The times the file was truncated (read from the start) */
+	unsigned long  replaced;  /* The times the file was replaced (reopened) */
+	int            deleted;   /* Flag indicating the file was deleted (not replaced) */
+} avparser_follow;
+
+/** Functional Prototypes **/
+avparser_follow *     open_avparser_follow( avparser_ctx *ctx, const char *path, int end, avparser_callback callback, void *data );
+long                  read_avparser_follow( avparser_follow *fl );
+int                   wait_avparser_follow( avparser_follow *fl, int timeout );
+void                  close_avparser_follow( avparser_follow *fl );
+
+#define AVFOLLOW_INCLUDED
+#endif
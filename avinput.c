@@ -0,0 +1,323 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avinput.c
+//  Description   : This file contains the input (block) reading code for the
+//                  avparse library.  Input is handed to the parsing engines 
+//                  as blocks of complete lines held in the context buffer.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Thu Nov 21 10:02:44 EST 2019
+*/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <avparse.h>
+#include <avinput.h>
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_avparser_input
+// Description  : setup the input for a parser context
+//
+// Inputs       : ctx - the parser context
+//                in - file handle for metar input (OR)
+//                metar - the string containing the METAR
+// Outputs      : none
+*/
+
+void set_avparser_input( avparser_ctx *ctx, FILE *in, char *metar ) {
+
+	/* Setup the string (or empty) input, then the file */
+	set_avparser_region( ctx, metar, (in == NULL) ? strlen(metar) : 0 );
+	ctx->in = in;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_avparser_region
+// Description  : setup a region of memory (need not be terminated) as the 
+//                input for a parser context, the region is copied into the 
+//                block buffer a block at a time and is never written
+//
+// Inputs       : ctx - the parser context
+//                data - the start of the region
+//                len - the length of the region
+// Outputs      : none
+*/
+
+void set_avparser_region( avparser_ctx *ctx, const char *data, size_t len ) {
+
+	/* Setup the input for the parser */
+	ctx->in = NULL;
+	ctx->metar = data;
+	ctx->metarlen = len;
+	ctx->eof = 0;
+	ctx->fill = ctx->blen = 0;
+	ctx->map = NULL;
+	ctx->maplen = ctx->mapoff = 0;
+
+	/* Create the block buffer on first use */
+	if ( ctx->buf == NULL ) {
+		if ( (ctx->buf = malloc(AVPARSE_BLOCK_SIZE)) == NULL ) {
+			AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+			exit(-1);
+		}
+		ctx->bufsz = AVPARSE_BLOCK_SIZE;
+	}
+	ctx->block = ctx->buf;
+
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : map_avparser_input
+// Description  : setup a memory mapped file as the input for a parser 
+//                context, the blocks are scanned directly in the mapping 
+//                (a private, writable mapping followed by zeroed padding 
+//                for the final newline and the scanner terminators)
+//
+// Inputs       : ctx - the parser context
+//                path - the path of the file to map
+// Outputs      : 0 if successful, -1 if the file could not be mapped
+*/
+
+int map_avparser_input( avparser_ctx *ctx, const char *path ) {
+
+	/* Local variables */
+	struct stat st;
+	char *map;
+	int fd;
+
+	/* Open the file, get the size */
+	if ( (fd = open(path, O_RDONLY)) == -1 ) {
+		return( -1 );
+	}
+	if ( fstat(fd, &st) == -1 ) {
+		close( fd );
+		return( -1 );
+	}
+
+	/* Reserve the file length plus padding, then map the file over it */
+	map = mmap( NULL, st.st_size + AVPARSE_BLOCK_PAD, PROT_READ|PROT_WRITE, 
+		MAP_PRIVATE|MAP_ANON, -1, 0 );
+	if ( map == MAP_FAILED ) {
+		close( fd );
+		return( -1 );
+	}
+	if ( (st.st_size > 0) && (mmap(map, st.st_size, PROT_READ|PROT_WRITE, 
+			MAP_PRIVATE|MAP_FIXED, fd, 0) == MAP_FAILED) ) {
+		munmap( map, st.st_size + AVPARSE_BLOCK_PAD );
+		close( fd );
+		return( -1 );
+	}
+	close( fd );
+	if ( st.st_size > 0 ) {
+		madvise( map, st.st_size, MADV_SEQUENTIAL );
+	}
+
+	/* Setup the context to read blocks from the mapping */
+	set_avparser_region( ctx, NULL, 0 );
+	ctx->map = map;
+	ctx->maplen = st.st_size;
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : next_avparser_map_block
+// Description  : find the next block of complete lines in the mapped input,
+//                the mapping is released at the end of the input
+//
+// Inputs       : ctx - the parser context
+// Outputs      : 1 if a block is ready to parse, 0 on end of input
+*/
+
+static int next_avparser_map_block( avparser_ctx *ctx ) {
+
+	/* Local variables */
+	char *start = ctx->map + ctx->mapoff, *eol;
+	size_t left = ctx->maplen - ctx->mapoff, len;
+
+	/* Release the mapping at the end of the input */
+	if ( left == 0 ) {
+		munmap( ctx->map, ctx->maplen + AVPARSE_BLOCK_PAD );
+		ctx->map = NULL;
+		ctx->maplen = ctx->mapoff = ctx->blen = 0;
+		return( 0 );
+	}
+
+	/* Block ends after the last newline in range (or the first after it) */
+	len = (left < AVPARSE_BLOCK_SIZE) ? left : AVPARSE_BLOCK_SIZE;
+	if ( len < left ) {
+		while ( (len > 0) && (start[len-1] != '\n') ) {
+			len --;
+		}
+		if ( (len == 0) && ((eol = memchr(start, '\n', left)) != NULL) ) {
+			len = (eol - start) + 1;
+		}
+	}
+	if ( len == 0 ) {
+		len = left;
+	}
+	ctx->mapoff += len;
+
+	/* Terminate a final partial line (in the padding) */
+	if ( start[len-1] != '\n' ) {
+		start[len++] = '\n';
+	}
+	ctx->block = start;
+	ctx->blen = len;
+	return( 1 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : read_avparser_input
+// Description  : read more raw input into the block buffer
+//
+// Inputs       : ctx - the parser context
+// Outputs      : the number of bytes read, 0 on end of input
+*/
+
+static size_t read_avparser_input( avparser_ctx *ctx ) {
+
+	/* Local variables */
+	size_t len = ctx->bufsz - AVPARSE_BLOCK_PAD - ctx->fill;
+
+	/* Copy from the string, or read from the file */
+	if ( ctx->in == NULL ) {
+		len = (len < ctx->metarlen) ? len : ctx->metarlen;
+		memcpy( ctx->buf + ctx->fill, ctx->metar, len );
+		ctx->metar += len;
+		ctx->metarlen -= len;
+	} else {
+		len = fread( ctx->buf + ctx->fill, 1, len, ctx->in );
+	}
+
+	/* Update the buffer, return the bytes read */
+	ctx->fill += len;
+	return( len );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : next_avparser_block
+// Description  : load the next block of complete lines into the context 
+//                buffer (buf, blen), the block stays in place (so tokens
+//                remain valid views) until the next block is loaded
+//
+// Inputs       : ctx - the parser context
+// Outputs      : 1 if a block is ready to parse, 0 on end of input
+*/
+
+int next_avparser_block( avparser_ctx *ctx ) {
+
+	/* Local variables */
+	size_t len, used;
+
+	/* Mapped input is scanned in place */
+	if ( ctx->map != NULL ) {
+		return( next_avparser_map_block(ctx) );
+	}
+
+	/* Drop the last block (which may have been moved up), move any partial
+	   line to the front */
+	used = (ctx->block + ctx->blen) - ctx->buf;
+	len = ctx->fill - used;
+	memmove( ctx->buf, ctx->buf + used, len );
+	ctx->fill = len;
+	ctx->blen = 0;
+
+	/* Fill the buffer until it holds at least one complete line */
+	while ( ctx->blen == 0 ) {
+
+		/* Read until full, or the input is exhausted */
+		while ( (! ctx->eof) && (ctx->fill < ctx->bufsz - AVPARSE_BLOCK_PAD) ) {
+			if ( read_avparser_input(ctx) == 0 ) {
+				ctx->eof = 1;
+			}
+		}
+
+		/* Block ends after the last newline, terminate a final partial line */
+		len = ctx->fill;
+		while ( (len > 0) && (ctx->buf[len-1] != '\n') ) {
+			len --;
+		}
+		if ( len > 0 ) {
+			ctx->blen = len;
+		} else if ( ctx->eof ) {
+			if ( (ctx->fill == 0) || ctx->follow ) {
+				return( 0 );
+			}
+			ctx->buf[ctx->fill++] = '\n';
+			ctx->blen = ctx->fill;
+		} else {
+			/* The line does not fit, grow the buffer */
+			if ( (ctx->buf = realloc(ctx->buf, ctx->bufsz * 2)) == NULL ) {
+				AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+				exit(-1);
+			}
+			ctx->bufsz *= 2;
+		}
+	}
+
+	/* Block is ready */
+	ctx->block = ctx->buf;
+	return( 1 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : resume_avparser_input
+// Description  : resume file input that was exhausted (the file has grown),
+//                a partial line left in the buffer (when following) is
+//                completed by the new input unless it is dropped
+//
+// Inputs       : ctx - the parser context
+//                keep - flag indicating the partial line should be kept
+// Outputs      : none
+*/
+
+void resume_avparser_input( avparser_ctx *ctx, int keep ) {
+
+	/* Clear the end of input, keep (or drop) the unparsed bytes */
+	if ( ctx->in != NULL ) {
+		clearerr( ctx->in );
+	}
+	ctx->eof = 0;
+	ctx->fill = (keep) ? ctx->fill : 0;
+	ctx->block = ctx->buf;
+	ctx->blen = 0;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : release_avparser_input
+// Description  : release the input block buffer of a parser context
+//
+// Inputs       : ctx - the parser context
+// Outputs      : none
+*/
+
+void release_avparser_input( avparser_ctx *ctx ) {
+
+	/* Unmap any mapped input, free the buffer, reset the input state */
+	if ( ctx->map != NULL ) {
+		munmap( ctx->map, ctx->maplen + AVPARSE_BLOCK_PAD );
+		ctx->map = NULL;
+	}
+	free( ctx->buf );
+	ctx->buf = NULL;
+	ctx->bufsz = ctx->fill = ctx->blen = 0;
+	return;
+}
@@ -0,0 +1,29 @@
+#ifndef AVINPUT_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avinput.h
+//  Description   : This file contains the definitions for the input (block)
+//                  reading of the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Thu Nov 21 10:02:44 EST 2019
+*/
+
+/** Include Files **/
+#include <stdio.h>
+#include <avparse.h>
+
+/** Definitions and Types **/
+#define AVPARSE_BLOCK_SIZE (64*1024) /* Initial size of the input block buffer */
+#define AVPARSE_BLOCK_PAD  3         /* Room for a final newline, terminators */
+
+/** Functional Prototypes **/
+void                  set_avparser_input( avparser_ctx *ctx, FILE *in, char *metar );
+void                  set_avparser_region( avparser_ctx *ctx, const char *data, size_t len );
+int                   map_avparser_input( avparser_ctx *ctx, const char *path );
+int                   next_avparser_block( avparser_ctx *ctx );
+void                  resume_avparser_input( avparser_ctx *ctx, int keep );
+void                  release_avparser_input( avparser_ctx *ctx );
+
+#define AVINPUT_INCLUDED
+#endif
@@ -0,0 +1,179 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avpacked.c
+//  Description   : This file contains the conversion between the reading 
+//                  structure and the compact (fixed size) packed record of
+//                  the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Wed Dec  4 10:27:51 EST 2019
+*/
+
+/* Includes */
+#include <string.h>
+#include <avparse.h>
+#include <avfldparse.h>
+#include <avpacked.h>
+
+/* Definitions */
+#define AVP_IN_RANGE(v, lo, hi) (((v) >= (lo)) && ((v) <= (hi)))
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : pack_avreading
+// Description  : pack a reading into a fixed size record, the record holds
+//                everything needed to rebuild the reading exactly (if the 
+//                conditions or layers do not fit, the first ones are packed
+//                and the record is flagged as truncated)
+//
+// Inputs       : avr - the reading to pack
+//                pkd - the packed record to fill
+// Outputs      : 0 if successful, -1 if the reading does not fit the record
+//                (the record is empty if the base fields do not fit)
+*/
+
+int pack_avreading( const avreading *avr, avreading_packed *pkd ) {
+
+	/* Local variables */
+	avreading_condition *cond;
+	avreading_coverage *cvg;
+	long gmtoff, altm;
+	int i;
+
+	/* Check the reading fits (whole minutes, field ranges) */
+	memset( pkd, 0x0, sizeof(avreading_packed) );
+	gmtoff = (long)(avr->rtime.local - avr->rtime.zulu);
+	altm = (long)((avr->raltm * 100) + ((avr->raltm < 0) ? -0.5 : 0.5));
+	if ( (avr->rtime.zulu < 0) || (avr->rtime.zulu % 60 != 0) || (avr->rtime.zulu / 60 > UINT32_MAX) ||
+		 (gmtoff % 60 != 0) || !AVP_IN_RANGE(gmtoff / 60, INT16_MIN, INT16_MAX) ||
+		 !AVP_IN_RANGE(avr->rwind.direction, 0, UINT16_MAX) || !AVP_IN_RANGE(avr->rwind.speed, 0, UINT8_MAX) ||
+		 !AVP_IN_RANGE(avr->rwind.gust, -1, INT8_MAX) || (avr->rviz > UINT8_MAX) || 
+		 !AVP_IN_RANGE(avr->rtemp.temperature_celsisus, INT8_MIN, INT8_MAX) ||
+		 !AVP_IN_RANGE(avr->rtemp.dewpoint_celsisus, INT8_MIN, INT8_MAX) ||
+		 (avr->rtemp.temperature_fahrenheit != (int)((avr->rtemp.temperature_celsisus * 1.8) + 32)) ||
+		 (avr->rtemp.dewpoint_fahrenheit != (int)((avr->rtemp.dewpoint_celsisus * 1.8) + 32)) ||
+		 !AVP_IN_RANGE(altm, 0, UINT16_MAX) || ((float)((float)altm/100.0) != avr->raltm) ) {
+		return( -1 );
+	}
+
+	/* Pack the base fields */
+	pkd->station = AVR_STATION_CODE( avr->field );
+	pkd->zulu = (uint32_t)(avr->rtime.zulu / 60);
+	pkd->gmtoff = (int16_t)(gmtoff / 60);
+	pkd->wind_direction = (uint16_t)avr->rwind.direction;
+	pkd->wind_speed = (uint8_t)avr->rwind.speed;
+	pkd->wind_gust = (int8_t)avr->rwind.gust;
+	pkd->visibility = (uint8_t)avr->rviz;
+	pkd->temperature = (int8_t)avr->rtemp.temperature_celsisus;
+	pkd->dewpoint = (int8_t)avr->rtemp.dewpoint_celsisus;
+	pkd->altimeter = (uint16_t)altm;
+	pkd->flags = (avr->rcorr) ? AVR_PACKED_CORRECTED : 0;
+	pkd->missing = (uint8_t)avr->rmissing;
+
+	/* Pack the condition groups (in order), and the set of conditions */
+	for ( cond = avr->rcond; cond != NULL; cond = cond->next ) {
+		if ( pkd->no_conds == AVR_PACKED_CONDS ) {
+			pkd->flags |= AVR_PACKED_TRUNCATED;
+			break;
+		}
+		for ( i = 0; i < AVR_MAX_CONDS; i ++ ) {
+			pkd->conds[pkd->no_conds] |= (uint32_t)cond->conditions[i] << (i * AVR_PACKED_COND_BITS);
+			pkd->cond_set |= (cond->conditions[i] != AVR_CONDITION_UN) ? (1U << cond->conditions[i]) : 0;
+		}
+		pkd->conds[pkd->no_conds] |= (uint32_t)cond->intensity << (AVR_MAX_CONDS * AVR_PACKED_COND_BITS);
+		pkd->no_conds ++;
+	}
+
+	/* Pack the cloud layers (in order) */
+	for ( cvg = avr->rcvrg; cvg != NULL; cvg = cvg->next ) {
+		if ( (pkd->no_layers == AVR_PACKED_LAYERS) || (cvg->altitude % 100 != 0) || 
+			 (cvg->altitude / 100 > 0x1fff) ) {
+			pkd->flags |= AVR_PACKED_TRUNCATED;
+			break;
+		}
+		pkd->layers[pkd->no_layers++] = AVR_PACKED_LAYER( cvg->coverage, cvg->altitude );
+	}
+
+	/* Return successfully (unless truncated) */
+	return( (pkd->flags & AVR_PACKED_TRUNCATED) ? -1 : 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : unpack_avreading
+// Description  : rebuild a reading from a packed record, the reading is 
+//                allocated from the parser output (not added to its list)
+//
+// Inputs       : pkd - the packed record
+//                avout - parser output structure to allocate from
+// Outputs      : a pointer to the rebuilt reading
+*/
+
+avreading * unpack_avreading( const avreading_packed *pkd, avparser_out *avout ) {
+
+	/* Local variables */
+	avreading *avr;
+	avreading_condition *cond, *ctail = NULL;
+	avreading_coverage *cvg, *vtail = NULL;
+	avparser_token tok;
+	char station[AVR_STATION_LEN];
+	int g, i;
+
+	/* Unpack the base fields (the station is interned in the output) */
+	avr = allocate_avparser_reading( avout );
+	station[0] = (char)(pkd->station >> 24);
+	station[1] = (char)(pkd->station >> 16);
+	station[2] = (char)(pkd->station >> 8);
+	station[3] = (char)pkd->station;
+	tok.str = station;
+	tok.len = AVR_STATION_LEN;
+	avr->field = intern_avparser_station( avout, tok );
+	avr->rtime.zulu = (time_t)pkd->zulu * 60;
+	avr->rtime.local = avr->rtime.zulu + (pkd->gmtoff * 60);
+	avr->rcorr = (pkd->flags & AVR_PACKED_CORRECTED) ? 1 : 0;
+	avr->rwind.direction = pkd->wind_direction;
+	avr->rwind.speed = pkd->wind_speed;
+	avr->rwind.gust = pkd->wind_gust;
+	avr->rviz = pkd->visibility;
+	avr->rtemp.temperature_celsisus = pkd->temperature;
+	avr->rtemp.dewpoint_celsisus = pkd->dewpoint;
+	avr->rtemp.temperature_fahrenheit = (avr->rtemp.temperature_celsisus * 1.8) + 32;
+	avr->rtemp.dewpoint_fahrenheit = (avr->rtemp.dewpoint_celsisus * 1.8) + 32;
+	avr->raltm = (float)pkd->altimeter/100.0;
+	avr->rmissing = pkd->missing;
+
+	/* Unpack the condition groups */
+	for ( g = 0; g < pkd->no_conds; g ++ ) {
+		cond = avarena_alloc( &avout->arena, sizeof(avreading_condition) );
+		for ( i = 0; i < AVR_MAX_CONDS; i ++ ) {
+			cond->conditions[i] = (avreading_conditions)AVR_PACKED_COND( pkd->conds[g], i );
+		}
+		cond->intensity = (avreading_condition_intensity)AVR_PACKED_INTENSITY( pkd->conds[g] );
+		cond->next = NULL;
+		if ( ctail == NULL ) {
+			avr->rcond = cond;
+		} else {
+			ctail->next = cond;
+		}
+		ctail = cond;
+	}
+
+	/* Unpack the cloud layers */
+	for ( g = 0; g < pkd->no_layers; g ++ ) {
+		cvg = avarena_alloc( &avout->arena, sizeof(avreading_coverage) );
+		cvg->coverage = (avreading_coverage_level)AVR_PACKED_COVERAGE( pkd->layers[g] );
+		cvg->altitude = AVR_PACKED_ALTITUDE( pkd->layers[g] );
+		cvg->next = NULL;
+		if ( vtail == NULL ) {
+			avr->rcvrg = cvg;
+		} else {
+			vtail->next = cvg;
+		}
+		vtail = cvg;
+	}
+
+	/* Return the rebuilt reading */
+	return( avr );
+}
@@ -0,0 +1,60 @@
+#ifndef AVPACKED_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avpacked.h
+//  Description   : This file contains the definitions for the compact (fixed
+//                  size) packed reading record of the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Wed Dec  4 10:27:51 EST 2019
+*/
+
+/** Include Files **/
+#include <stdint.h>
+#include <avparse.h>
+
+/** Definitions and Types **/
+#define AVR_PACKED_CONDS  3   /* Condition groups held in a packed record */
+#define AVR_PACKED_LAYERS 6   /* Cloud layers held in a packed record */
+#define AVR_PACKED_CORRECTED 0x1 /* Flag bit, corrected report */
+#define AVR_PACKED_TRUNCATED 0x2 /* Flag bit, groups or layers did not fit */
+
+/* Condition group packing, 5 bits per condition (in order) then intensity */
+#define AVR_PACKED_COND_BITS 5
+#define AVR_PACKED_COND(g, i) (((g) >> ((i) * AVR_PACKED_COND_BITS)) & 0x1f)
+#define AVR_PACKED_INTENSITY(g) (((g) >> (AVR_MAX_CONDS * AVR_PACKED_COND_BITS)) & 0x3)
+
+/* Cloud layer packing, coverage (3 bits) over altitude in 100s of feet */
+#define AVR_PACKED_LAYER(cvg, alt) ((uint16_t)(((cvg) << 13) | ((alt) / 100)))
+#define AVR_PACKED_COVERAGE(l) ((l) >> 13)
+#define AVR_PACKED_ALTITUDE(l) (((l) & 0x1fff) * 100)
+
+/* A reading packed into a fixed size record (no pointers) */
+typedef struct avreading_packed_struct {
+	uint32_t  station;        /* The packed station code */
+	uint32_t  zulu;           /* The (zulu) time, minutes since the epoch */
+	uint32_t  cond_set;       /* Bitset of all conditions in the reading */
+	uint32_t  conds[AVR_PACKED_CONDS];   /* Packed condition groups */
+	uint16_t  layers[AVR_PACKED_LAYERS]; /* Packed cloud layers */
+	int16_t   gmtoff;         /* Local time offset, in minutes */
+	uint16_t  wind_direction; /* The wind direction (0-359) */
+	uint16_t  altimeter;      /* The altimeter, in hundredths of inches */
+	uint8_t   wind_speed;     /* The wind speed, in kts */
+	int8_t    wind_gust;      /* The wind gust (-1 no gust) */
+	uint8_t   visibility;     /* The visibility (in SM) */
+	int8_t    temperature;    /* The temperature (celsisus) */
+	int8_t    dewpoint;       /* The dewpoint (celsisus) */
+	uint8_t   flags;          /* Report flags (corrected) */
+	uint8_t   no_conds;       /* The number of condition groups */
+	uint8_t   no_layers;      /* The number of cloud layers */
+	uint8_t   missing;        /* The fields not decoded (AVR_FIELD_*) */
+} avreading_packed;
+
+_Static_assert( sizeof(avreading_packed) <= 64, "packed reading must fit in 64 bytes" );
+
+/** Functional Prototypes **/
+int                   pack_avreading( const avreading *avr, avreading_packed *pkd );
+avreading *           unpack_avreading( const avreading_packed *pkd, avparser_out *avout );
+
+#define AVPACKED_INCLUDED
+#endif
@@ -9,22 +9,444 @@
 
 // Includes
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
 #include <unistd.h>
 #include <avparse.h>
 #include <avfldparse.h>
+#include <avcorpus.h>
+#include <avthread.h>
+#include <avdedup.h>
+#include <avfilter.h>
+#include <avwriter.h>
+#include <avpacked.h>
+#include <avbinary.h>
+#include <avarchive.h>
+#include <avstats.h>
+#include <avfollow.h>
 
 // Definitions
-#define AVPARSE_ARGUMENTS "htdf:"
+#define AVPARSE_ARGUMENTS "htdf:F:mj:e:cSsu:i:p:o:b:r:a:A:g:"
+#define AVPARSE_TEST_METAR "KUNV 051253Z 05004KT 10SM SKC 05/03 A3042"
+#define AVPARSE_FOLLOW_WAIT 1000 /* Milliseconds between checks of a followed file */
 #define AVPARSE_USAGE \
-    "\nUSAGE: avparse [-f <input file>] [-h] [-d]\n" \
+    "\nUSAGE: avparse [-f <input file>] [-F <feed file>] [-m] [-j <threads>] [-e <engine>] [-c] [-S] [-s] [-u <lines>] [-i <stations>] [-p <fields>] [-o <format>] [-b <binary file>] [-r <binary file>] [-a <archive>] [-A <archive>] [-g <lines>] [-h] [-d] [-t]\n" \
     "\n" \
     "where:\n" \
 	"    -f - use file input from text file, where <input file> is the filename.\n" \
+	"    -F - follow <feed file> (parse it, then each line appended to it,\n" \
+	"         printing the readings as they are parsed, until interrupted\n" \
+	"         or the file is deleted).\n" \
+	"    -m - memory map the input file (bulk ingest, needs -f).\n" \
+	"    -j - parse the input file with <threads> threads (needs -f).\n" \
+	"    -e - parsing engine, where <engine> is grammar (default) or decoder.\n" \
+	"    -c - compare mode (parse with both engines, report any differences).\n" \
+	"    -S - streaming mode (print each reading as it is parsed).\n" \
+	"    -s - print parse statistics (counts, timings, latency) to stderr\n" \
+	"         (needs a build with STATS=1).\n" \
+	"    -u - skip repeated lines, remembering the last <lines> lines seen.\n" \
+	"    -i - parse only the reports of <stations> (comma separated codes).\n" \
+	"    -p - decode only <fields> (comma separated, of time, wind, visibility,\n" \
+	"         conditions, coverage, temperature and altimeter, the time is\n" \
+	"         always decoded).\n" \
+	"    -o - output format, where <format> is text (default), jsonl or csv.\n" \
+	"    -b - write the readings to <binary file> (binary format) instead.\n" \
+	"    -r - read the readings from <binary file> (binary format, no parse).\n" \
+	"    -a - write the readings to <archive> (compressed, by station) instead.\n" \
+	"    -A - read the readings from <archive> (by station, in time order).\n" \
+	"    -g - generate a synthetic METAR corpus of <lines> reports to stdout\n" \
+	"         (<lines>,<n> makes one in <n> lines malformed).\n" \
 	"    -h - help mode (display this message)\n" \
-    "    -d - debug mode (enables parse trace)\n\n"
+    "    -d - debug mode (enables parse trace)\n" \
+    "    -t - test mode (parse a single built in report)\n\n"
+
+// The fields that can be selected (-p)
+static const char *avparse_field_names[] = { "time", "wind", "visibility", "conditions", 
+	"coverage", "temperature", "altimeter", NULL };
+
+// Flag set when a followed file should no longer be followed (signal)
+static volatile sig_atomic_t avparse_stop = 0;
 
 // Functional prototypes (to keep the compiler happy) */
 
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_print_reading
+// Description  : print a reading (streaming mode callback)
+//
+// Inputs       : avr - the reading to print
+//                data - the writer to print with
+// Outputs      : none
+*/
+
+static void avparse_print_reading( avreading *avr, void *data ) {
+
+	/* Write the reading (the writer flushes in large blocks) */
+	write_avparser_reading( (avparser_writer *)data, avr );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_store_reading
+// Description  : add a reading to a binary file (streaming mode callback)
+//
+// Inputs       : avr - the reading to add
+//                data - the binary file writer
+// Outputs      : none
+*/
+
+static void avparse_store_reading( avreading *avr, void *data ) {
+
+	/* Add the reading as the next record */
+	add_avparser_binary( (avbinary_writer *)data, avr );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_archive_reading
+// Description  : add a reading to an archive (streaming mode callback)
+//
+// Inputs       : avr - the reading to add
+//                data - the archive writer
+// Outputs      : none
+*/
+
+static void avparse_archive_reading( avreading *avr, void *data ) {
+
+	/* Add the reading (written when the archive is finished) */
+	add_avparser_archive( (avarchive_writer *)data, avr );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_finish_archive
+// Description  : finish the archive written (report truncated and rejected
+//                readings)
+//
+// Inputs       : aw - the archive writer
+//                archfile - the archive file name
+// Outputs      : 0 if successful, -1 if the file could not be written
+*/
+
+static int avparse_finish_archive( avarchive_writer *aw, char *archfile ) {
+
+	/* Report the readings that did not fit a record, then finish */
+	if ( aw->truncated > 0 ) {
+		fprintf( stderr, "Truncated %lu readings (too many condition groups or cloud layers).\n", 
+				 aw->truncated );
+	}
+	if ( aw->rejected > 0 ) {
+		fprintf( stderr, "Rejected %lu readings (fields out of the range of a record).\n", 
+				 aw->rejected );
+	}
+	if ( finish_avparser_archive(aw) != 0 ) {
+		fprintf( stderr, "Unable to write archive (%s).\n", archfile );
+		return( -1 );
+	}
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_read_binary
+// Description  : print the readings of a binary file (the records are
+//                unpacked one at a time, the reading memory is reused), or
+//                copy them to an archive
+//
+// Inputs       : binfile - the binary file to read
+//                format - the format to print the readings in
+//                archfile - the archive to write (NULL to print)
+// Outputs      : 0 if successful, -1 if the file could not be read
+*/
+
+static int avparse_read_binary( char *binfile, avparser_format format, char *archfile ) {
+
+	/* Local variables */
+	avparser_binary *bin;
+	avarchive_writer *aw;
+	avparser_writer *wr;
+	avparser_out *avout;
+	uint64_t i;
+
+	/* Map the file */
+	if ( (bin = open_avparser_binary(binfile)) == NULL ) {
+		fprintf( stderr, "Unable to read binary file (%s), aborting.\n", binfile );
+		return( -1 );
+	}
+
+	/* Copy the records to the archive (as they are, less any empty record
+	   of a reading that did not pack, from files written before these were
+	   skipped) */
+	if ( archfile != NULL ) {
+		if ( (aw = create_avparser_archive(archfile)) == NULL ) {
+			fprintf( stderr, "Unable to create archive (%s), aborting.\n", archfile );
+			close_avparser_binary( bin );
+			return( -1 );
+		}
+		for ( i = 0; i < bin->no_records; i ++ ) {
+			if ( bin->records[i].station == 0 ) {
+				aw->rejected ++;
+				continue;
+			}
+			add_avparser_archive_record( aw, &bin->records[i] );
+		}
+		close_avparser_binary( bin );
+		return( avparse_finish_archive(aw, archfile) );
+	}
+
+	/* Write out each record */
+	avout = allocate_avparser_struct();
+	wr = allocate_avparser_writer( stdout, -1 );
+	wr->format = format;
+	for ( i = 0; i < bin->no_records; i ++ ) {
+		write_avparser_reading( wr, unpack_avreading(&bin->records[i], avout) );
+		avarena_reset( &avout->arena );
+	}
+	release_avparser_writer( wr );
+	release_avparser_struct( avout );
+	close_avparser_binary( bin );
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_read_archive
+// Description  : print the readings of an archive (station by station, in
+//                time order, a station is decoded at a time)
+//
+// Inputs       : archfile - the archive to read
+//                format - the format to print the readings in
+// Outputs      : 0 if successful, -1 if the archive could not be read
+*/
+
+static int avparse_read_archive( char *archfile, avparser_format format ) {
+
+	/* Local variables */
+	avparser_archive *arc;
+	avreading_packed *recs = NULL;
+	avparser_writer *wr;
+	avparser_out *avout;
+	uint32_t s, max = 0;
+	long n, i;
+	int ret = 0;
+
+	/* Map the archive */
+	if ( (arc = open_avparser_archive(archfile)) == NULL ) {
+		fprintf( stderr, "Unable to read archive (%s), aborting.\n", archfile );
+		return( -1 );
+	}
+
+	/* Decode each station, then write out its readings */
+	avout = allocate_avparser_struct();
+	wr = allocate_avparser_writer( stdout, -1 );
+	wr->format = format;
+	for ( s = 0; (s < arc->no_stations) && (ret == 0); s ++ ) {
+		if ( arc->stations[s].no_records > max ) {
+			max = arc->stations[s].no_records;
+			if ( (recs = realloc(recs, max * sizeof(avreading_packed))) == NULL ) {
+				AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+				exit(-1);
+			}
+		}
+		if ( (n = read_avparser_archive_station(arc, &arc->stations[s], recs)) < 0 ) {
+			fprintf( stderr, "Corrupt archive (%s), station %.4s.\n", archfile, arc->stations[s].name );
+			ret = -1;
+		}
+		for ( i = 0; i < n; i ++ ) {
+			write_avparser_reading( wr, unpack_avreading(&recs[i], avout) );
+			avarena_reset( &avout->arena );
+		}
+	}
+	release_avparser_writer( wr );
+	release_avparser_struct( avout );
+	free( recs );
+	close_avparser_archive( arc );
+	return( ret );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_finish_binary
+// Description  : finish the binary file written (report truncated and
+//                rejected records)
+//
+// Inputs       : bw - the binary file writer
+//                binfile - the binary file name
+// Outputs      : 0 if successful, -1 if the file could not be written
+*/
+
+static int avparse_finish_binary( avbinary_writer *bw, char *binfile ) {
+
+	/* Report the readings that did not fit a record, then finish */
+	if ( bw->truncated > 0 ) {
+		fprintf( stderr, "Truncated %lu readings (too many condition groups or cloud layers).\n", 
+				 bw->truncated );
+	}
+	if ( bw->rejected > 0 ) {
+		fprintf( stderr, "Rejected %lu readings (fields out of the range of a record).\n", 
+				 bw->rejected );
+	}
+	if ( finish_avparser_binary(bw) != 0 ) {
+		fprintf( stderr, "Unable to write binary file (%s).\n", binfile );
+		return( -1 );
+	}
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_print_dedup
+// Description  : print the repeated line counters (if lines were checked)
+//
+// Inputs       : dedup - the cache of lines (NULL if none)
+// Outputs      : none
+*/
+
+static void avparse_print_dedup( avparser_dedup *dedup ) {
+
+	/* Print the hits and misses of the cache */
+	if ( dedup != NULL ) {
+		fprintf( stderr, "Repeated lines: %lu skipped (hits), %lu parsed (misses).\n", 
+				 dedup->hits, dedup->misses );
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_print_stats
+// Description  : print the parse statistics of the context (if requested)
+//
+// Inputs       : ctx - the parser context
+//                stats - flag indicating the statistics should be printed
+// Outputs      : none
+*/
+
+static void avparse_print_stats( avparser_ctx *ctx, int stats ) {
+
+	/* Local variables */
+	avparser_stats st;
+
+	/* Get the statistics, print the summary */
+	if ( stats && (get_avparser_stats(ctx, &st) == 0) ) {
+		print_avparser_stats( &st, stderr );
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_signal
+// Description  : stop following the feed file (SIGINT, SIGTERM handler)
+//
+// Inputs       : sig - the signal caught
+// Outputs      : none
+*/
+
+static void avparse_signal( int sig ) {
+
+	/* Flag the follow loop to stop */
+	avparse_stop = 1;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_follow
+// Description  : follow a feed file, printing the readings of the lines
+//                appended to it as they are parsed, until interrupted (or
+//                the file is deleted)
+//
+// Inputs       : ctx - the parser context
+//                feedfile - the file to follow
+//                format - the format to print readings in
+// Outputs      : 0 if successful, -1 if the file could not be followed
+*/
+
+static int avparse_follow( avparser_ctx *ctx, char *feedfile, avparser_format format ) {
+
+	/* Local variables */
+	struct sigaction sa;
+	avparser_follow *fl;
+	avparser_writer *wr;
+	int ret = 0;
+
+	/* Stop on an interrupt (the wait is not restarted) */
+	memset( &sa, 0x0, sizeof(struct sigaction) );
+	sa.sa_handler = avparse_signal;
+	sigemptyset( &sa.sa_mask );
+	sigaction( SIGINT, &sa, NULL );
+	sigaction( SIGTERM, &sa, NULL );
+
+	/* Open the file, the readings are written straight to the output */
+	wr = allocate_avparser_writer( NULL, STDOUT_FILENO );
+	wr->format = format;
+	wr->stats = ctx->stats;
+	if ( (fl = open_avparser_follow(ctx, feedfile, 0, avparse_print_reading, wr)) == NULL ) {
+		fprintf( stderr, "Unable to open feed file (%s), aborting.\n", feedfile );
+		release_avparser_writer( wr );
+		return( -1 );
+	}
+
+	/* Parse what was appended, write it out, wait for more */
+	while ( ! avparse_stop ) {
+		if ( read_avparser_follow(fl) > 0 ) {
+			flush_avparser_writer( wr );
+		}
+		if ( fl->deleted ) {
+			fprintf( stderr, "Feed file (%s) deleted, stopping.\n", feedfile );
+			break;
+		}
+		if ( (wait_avparser_follow(fl, AVPARSE_FOLLOW_WAIT) < 0) && (errno != EINTR) ) {
+			fprintf( stderr, "Unable to wait for feed file (%s), aborting.\n", feedfile );
+			ret = -1;
+			break;
+		}
+	}
+
+	/* Report the file changes, close the file */
+	if ( (fl->truncated > 0) || (fl->replaced > 0) ) {
+		fprintf( stderr, "Feed file truncated %lu times, replaced %lu times.\n", 
+				 fl->truncated, fl->replaced );
+	}
+	close_avparser_follow( fl );
+	if ( release_avparser_writer(wr) != 0 ) {
+		ret = -1;
+	}
+	return( ret );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparse_input
+// Description  : parse the input the way selected on the command line
+//
+// Inputs       : ctx - the parser context (holds the engine)
+//                in - the input file handle (stdio input)
+//                infile - the input file name (mapped, threaded input)
+//                test - flag indicating the test report should be parsed
+//                mapped - flag indicating the file should be memory mapped
+//                threads - the number of threads to parse with (0 if none)
+// Outputs      : a pointer to the parsed data, NULL if the input file could
+//                not be mapped
+*/
+
+static avparser_out * avparse_input( avparser_ctx *ctx, FILE *in, char *infile, int test, int mapped, int threads ) {
+
+	/* Parse in the selected mode */
+	if ( threads > 0 ) {
+		return( avreading_metar_parse_threads(ctx->engine, infile, threads) );
+	}
+	if ( mapped ) {
+		return( avreading_metar_parse_mmap(ctx, infile) );
+	}
+	return( avreading_metar_parse_ctx(ctx, (test) ? NULL : in, AVPARSE_TEST_METAR) );
+}
 
 
 /*/////////////////////////////////////////////////////////////////////////////
@@ -41,8 +463,22 @@
 int main(int argc, char **argv) {
 
 	// Local variables
-	char ch, *infile;
-	int test = 0;
+	char ch, *infile = NULL, *stations = NULL, *code, *binfile = NULL, *readfile = NULL;
+	char *archfile = NULL, *readarch = NULL, *feedfile = NULL;
+	unsigned int fields = AVR_FIELD_ALL, i;
+	int test = 0, compare = 0, mapped = 0, threads = 0, stream = 0, stats = 0, diffs, ret = 0;
+	unsigned int unique = 0;
+	long corpus = -1;
+	unsigned int malformed = 0;
+	FILE *in = stdin;
+	avparser_ctx *ctx;
+	avparser_out *avout, *avcmp;
+	avparser_writer *wr;
+	avbinary_writer *bw;
+	avarchive_writer *aw;
+	avreading *avr;
+	avparser_engine engine = AVP_ENGINE_GRAMMAR;
+	avparser_format format = AVP_FORMAT_TEXT;
 
 	// Process the command line parameters
     while ((ch = getopt(argc, argv, AVPARSE_ARGUMENTS)) != -1) {
@@ -60,6 +496,95 @@ int main(int argc, char **argv) {
             		infile = optarg;
             		break;
 
+            case 'F': // Follow a feed file
+            		feedfile = optarg;
+            		break;
+
+            case 'm': // Memory mapped input
+            		mapped = 1;
+            		break;
+
+            case 'j': // Threaded parsing
+            		threads = atoi(optarg);
+            		break;
+
+            case 'e': // Parsing engine
+            		if ( strcmp(optarg, "grammar") == 0 ) {
+            			engine = AVP_ENGINE_GRAMMAR;
+            		} else if ( strcmp(optarg, "decoder") == 0 ) {
+            			engine = AVP_ENGINE_DECODER;
+            		} else {
+	                    fprintf( stderr, "Unknown parsing engine (%s), aborting.\n", optarg );
+	                    return( -1 );
+            		}
+            		break;
+
+            case 'c': // Compare the engines
+            		compare = 1;
+            		break;
+
+            case 'S': // Streaming mode
+            		stream = 1;
+            		break;
+
+            case 's': // Parse statistics
+            		stats = 1;
+            		break;
+
+            case 'u': // Skip repeated lines
+            		unique = (unsigned int)atoi(optarg);
+            		break;
+
+            case 'i': // Parse only some stations
+            		stations = optarg;
+            		break;
+
+            case 'p': // Decode only some fields
+            		fields = 0;
+            		for ( code = strtok(optarg, ","); code != NULL; code = strtok(NULL, ",") ) {
+            			for ( i = 0; (avparse_field_names[i] != NULL) && (strcmp(code, avparse_field_names[i]) != 0); i ++ );
+            			if ( avparse_field_names[i] == NULL ) {
+            				fprintf( stderr, "Unknown field (%s), aborting.\n", code );
+            				return( -1 );
+            			}
+            			fields |= (1 << i);
+            		}
+            		break;
+
+            case 'o': // Output format
+            		if ( strcmp(optarg, "text") == 0 ) {
+            			format = AVP_FORMAT_TEXT;
+            		} else if ( strcmp(optarg, "jsonl") == 0 ) {
+            			format = AVP_FORMAT_JSONL;
+            		} else if ( strcmp(optarg, "csv") == 0 ) {
+            			format = AVP_FORMAT_CSV;
+            		} else {
+	                    fprintf( stderr, "Unknown output format (%s), aborting.\n", optarg );
+	                    return( -1 );
+            		}
+            		break;
+
+            case 'b': // Binary file output
+            		binfile = optarg;
+            		break;
+
+            case 'r': // Binary file input
+            		readfile = optarg;
+            		break;
+
+            case 'a': // Archive output
+            		archfile = optarg;
+            		break;
+
+            case 'A': // Archive input
+            		readarch = optarg;
+            		break;
+
+            case 'g': // Generate a corpus
+            		corpus = strtol(optarg, &code, 10);
+            		malformed = (*code == ',') ? (unsigned int)atoi(code + 1) : 0;
+            		break;
+
             case 't': // Perform the test
             		test = 1;
             		break;
@@ -70,17 +595,187 @@ int main(int argc, char **argv) {
             }
     }
 
-    // Check for testing of approach
-    if ( test ) {
-       	avreading_metar_parse(NULL, "KUNV 051253Z 05004KT 10SM SKC 05/03 A3042");
-    } else {
-    	avreading_metar_parse((infile == NULL) ? stdin : fopen(infile, "r"), NULL);
+    // Generate the corpus, if requested
+    if ( corpus >= 0 ) {
+    	generate_avparser_corpus( stdout, corpus, 1, malformed );
+    	return( 0 );
+    }
+
+    // Print a binary file or archive, if requested (the records are not parsed)
+    if ( (binfile != NULL) && (archfile != NULL) ) {
+    	fprintf( stderr, "Binary output (-b) cannot be combined with -a, aborting.\n" );
+    	return( -1 );
+    }
+    if ( readfile != NULL ) {
+    	return( avparse_read_binary(readfile, format, archfile) );
+    }
+    if ( readarch != NULL ) {
+    	return( avparse_read_archive(readarch, format) );
     }
 
-	/* Print out and free the structure */
-	print_parsed_input(avout);
+    // Open the input file, if one was given (mapped files are opened by the parser)
+    if ( (mapped || threads) && (test || (infile == NULL)) ) {
+    	fprintf( stderr, "Mapped (-m) and threaded (-j) input need file input (-f), aborting.\n" );
+    	return( -1 );
+    }
+    if ( compare && (! test) && (infile == NULL) ) {
+    	fprintf( stderr, "Compare mode needs file (-f) or test (-t) input, aborting.\n" );
+    	return( -1 );
+    }
+    if ( stream && (mapped || threads || compare) ) {
+    	fprintf( stderr, "Streaming mode (-S) cannot be combined with -m, -j or -c, aborting.\n" );
+    	return( -1 );
+    }
+    if ( (unique || stations) && (threads || compare) ) {
+    	fprintf( stderr, "Filtering lines (-u, -i) cannot be combined with -j or -c, aborting.\n" );
+    	return( -1 );
+    }
+    if ( ((binfile != NULL) || (archfile != NULL)) && compare ) {
+    	fprintf( stderr, "Binary output (-b, -a) cannot be combined with -c, aborting.\n" );
+    	return( -1 );
+    }
+    if ( (fields != AVR_FIELD_ALL) && threads ) {
+    	fprintf( stderr, "Decoding some fields (-p) cannot be combined with -j, aborting.\n" );
+    	return( -1 );
+    }
+    if ( (feedfile != NULL) && ((infile != NULL) || test || mapped || threads || compare || 
+    		(binfile != NULL) || (archfile != NULL)) ) {
+    	fprintf( stderr, "Following a file (-F) cannot be combined with -f, -t, -m, -j, -c, -b or -a, aborting.\n" );
+    	return( -1 );
+    }
+    if ( stats && (threads || compare) ) {
+    	fprintf( stderr, "Statistics (-s) cannot be combined with -j or -c, aborting.\n" );
+    	return( -1 );
+    }
+    if ( stats && (! avparser_stats_enabled()) ) {
+    	fprintf( stderr, "Statistics (-s) are not compiled in (build with STATS=1), aborting.\n" );
+    	return( -1 );
+    }
+    mapped = mapped || threads;
+    if ( (! test) && (! mapped) && (infile != NULL) && ((in = fopen(infile, "r")) == NULL) ) {
+    	fprintf( stderr, "Unable to open input file (%s), aborting.\n", infile );
+    	return( -1 );
+    }
+
+    // Follow or streaming mode, print the readings as they are parsed
+    ctx = allocate_avparser_ctx();
+    ctx->fields = fields;
+    ctx->dedup = (unique) ? allocate_avparser_dedup(unique) : NULL;
+    if ( stations != NULL ) {
+    	ctx->include = allocate_avparser_station_set();
+    	for ( code = strtok(stations, ","); code != NULL; code = strtok(NULL, ",") ) {
+    		if ( add_avparser_station_set(ctx->include, code) != 0 ) {
+    			fprintf( stderr, "Bad station code (%s), aborting.\n", code );
+    			return( -1 );
+    		}
+    	}
+    }
+    if ( feedfile != NULL ) {
+    	ctx->engine = engine;
+    	ret = avparse_follow( ctx, feedfile, format );
+    	if ( ctx->errors > 0 ) {
+    		fprintf( stderr, "Skipped %ld bad lines.\n", ctx->errors );
+    	}
+    	avparse_print_dedup( ctx->dedup );
+    	avparse_print_stats( ctx, stats );
+    	release_avparser_dedup(ctx->dedup);
+    	release_avparser_station_set(ctx->include);
+    	release_avparser_ctx(ctx);
+    	return( ret );
+    }
+    if ( stream ) {
+    	ctx->engine = engine;
+    	if ( binfile != NULL ) {
+    		if ( (bw = create_avparser_binary(binfile)) == NULL ) {
+    			fprintf( stderr, "Unable to create binary file (%s), aborting.\n", binfile );
+    			return( -1 );
+    		}
+    		avreading_metar_stream(ctx, (test) ? NULL : in, AVPARSE_TEST_METAR, avparse_store_reading, bw);
+    		ret = avparse_finish_binary( bw, binfile );
+    	} else if ( archfile != NULL ) {
+    		if ( (aw = create_avparser_archive(archfile)) == NULL ) {
+    			fprintf( stderr, "Unable to create archive (%s), aborting.\n", archfile );
+    			return( -1 );
+    		}
+    		avreading_metar_stream(ctx, (test) ? NULL : in, AVPARSE_TEST_METAR, avparse_archive_reading, aw);
+    		ret = avparse_finish_archive( aw, archfile );
+    	} else {
+    		wr = allocate_avparser_writer( stdout, -1 );
+    		wr->format = format;
+    		wr->stats = ctx->stats;
+    		avreading_metar_stream(ctx, (test) ? NULL : in, AVPARSE_TEST_METAR, avparse_print_reading, wr);
+    		release_avparser_writer( wr );
+    	}
+    	if ( ctx->errors > 0 ) {
+    		fprintf( stderr, "Skipped %ld bad lines.\n", ctx->errors );
+    	}
+    	avparse_print_dedup( ctx->dedup );
+    	avparse_print_stats( ctx, stats );
+    	release_avparser_dedup(ctx->dedup);
+    	release_avparser_station_set(ctx->include);
+    	release_avparser_ctx(ctx);
+    	return( ret );
+    }
+
+    // Parse the input (with the engine selected)
+    ctx->engine = (compare) ? AVP_ENGINE_GRAMMAR : engine;
+    if ( (avout = avparse_input(ctx, in, infile, test, mapped, threads)) == NULL ) {
+    	fprintf( stderr, "Unable to map input file (%s), aborting.\n", infile );
+    	return( -1 );
+    }
+
+    // Compare mode, parse again with the decoder and report differences
+    if ( compare ) {
+    	if ( (! test) && (! mapped) ) {
+    		rewind( in );
+    	}
+    	ctx->engine = AVP_ENGINE_DECODER;
+	    if ( (avcmp = avparse_input(ctx, in, infile, test, mapped, threads)) == NULL ) {
+	    	fprintf( stderr, "Unable to map input file (%s), aborting.\n", infile );
+	    	return( -1 );
+	    }
+	    diffs = compare_avparser_struct( avout, avcmp, stdout );
+	    printf( "Compared %d readings, %d differences.\n", avout->no_readings, diffs );
+	    release_avparser_struct(avcmp);
+	    release_avparser_struct(avout);
+	    release_avparser_ctx(ctx);
+	    return( (diffs == 0) ? 0 : 1 );
+    }
+
+	/* Print out (the readings, or a binary file or archive, then the bad lines) and free the structure */
+	if ( binfile != NULL ) {
+		if ( (bw = create_avparser_binary(binfile)) == NULL ) {
+			fprintf( stderr, "Unable to create binary file (%s), aborting.\n", binfile );
+			return( -1 );
+		}
+		for ( avr = avout->readings; avr != NULL; avr = avr->next ) {
+			add_avparser_binary( bw, avr );
+		}
+		ret = avparse_finish_binary( bw, binfile );
+	} else if ( archfile != NULL ) {
+		if ( (aw = create_avparser_archive(archfile)) == NULL ) {
+			fprintf( stderr, "Unable to create archive (%s), aborting.\n", archfile );
+			return( -1 );
+		}
+		for ( avr = avout->readings; avr != NULL; avr = avr->next ) {
+			add_avparser_archive( aw, avr );
+		}
+		ret = avparse_finish_archive( aw, archfile );
+	} else {
+		wr = allocate_avparser_writer( stdout, -1 );
+		wr->format = format;
+		wr->stats = ctx->stats;
+		write_parsed_input( wr, avout );
+		release_avparser_writer( wr );
+	}
+	print_parsed_errors(avout, stderr);
+	avparse_print_dedup( ctx->dedup );
+	avparse_print_stats( ctx, stats );
 	release_avparser_struct(avout);
+	release_avparser_dedup(ctx->dedup);
+	release_avparser_station_set(ctx->include);
+	release_avparser_ctx(ctx);
 
 	/* Exit the program normally */
-	return( 0 );
+	return( ret );
 }
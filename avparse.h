@@ -11,13 +11,41 @@
 
 /** Include Files **/
 #include <stdio.h>
+#include <stdint.h>
 #include <time.h>
+#include <avarena.h>
 
 /** Macros **/
 #define AVPARSE_FATAL_ERROR(s) fprintf(stderr, "%s at %s, line %d aborting.\n", s, __FILE__, __LINE__);
 
 /** Definitions and Types **/
 #define AVR_MAX_CONDS 5
+#define AVR_STATION_LEN 4 /* Length of the (ICAO) station code */
+
+/* Fields of a reading to decode (the station and time are always decoded,
+   the readings of a station are ordered by time, the other groups are still
+   checked by the scanner, but are marked missing) */
+#define AVR_FIELD_TIME        0x01
+#define AVR_FIELD_WIND        0x02
+#define AVR_FIELD_VISIBILITY  0x04
+#define AVR_FIELD_CONDITIONS  0x08
+#define AVR_FIELD_COVERAGE    0x10
+#define AVR_FIELD_TEMPERATURE 0x20
+#define AVR_FIELD_ALTIMETER   0x40
+#define AVR_FIELD_ALL         0x7f
+#define AVR_FIELD_WANTED(ctx, f) (((ctx)->fields & (f)) != 0)
+
+/* Pack a 4-letter station code into an integer key */
+#define AVR_STATION_CODE(s) (((uint32_t)(unsigned char)(s)[0] << 24) | \
+                             ((uint32_t)(unsigned char)(s)[1] << 16) | \
+                             ((uint32_t)(unsigned char)(s)[2] << 8) | \
+                              (uint32_t)(unsigned char)(s)[3])
+
+/* A token, a view (pointer, length) into the scanned input */
+typedef struct avparser_token_struct {
+	const char *str;  /* The start of the token text (not terminated) */
+	size_t      len;  /* The length of the token text */
+} avparser_token;
 
 /* Time structure for aviation reports */
 typedef struct avr_time_struct {
@@ -25,6 +53,15 @@ typedef struct avr_time_struct {
 	time_t local; /* The local time */
 } avreading_time;
 
+/* Time base for converting report (DDHHMMZ) times, computed once per batch */
+typedef struct avr_timebase_struct {
+	time_t now;        /* The time the base was computed for */
+	int    mday;       /* The current (UTC) day of the month */
+	time_t month;      /* The start of the current (UTC) month */
+	time_t prev_month; /* The start of the previous (UTC) month */
+	long   gmtoff;     /* The local offset from UTC (seconds) */
+} avreading_timebase;
+
 /* Wind structure */
 typedef struct avr_wind_struct {
 	int speed;     /* The wind speed, in kts */
@@ -93,6 +130,13 @@ typedef enum avreading_condition_enum {
 
 } avreading_conditions;
 
+/* Condition code (two letter) lookup table index and lookup */
+#define AVR_CONDITION_CODES (26*26)
+#define AVR_CONDITION_INDEX(a, b) ((((a) - 'A') * 26) + ((b) - 'A'))
+#define AVR_CONDITION_LOOKUP(a, b) \
+	((((unsigned char)((a) - 'A') < 26) && ((unsigned char)((b) - 'A') < 26)) ? \
+	 (avreading_conditions)avr_condition_codes[AVR_CONDITION_INDEX(a, b)] : AVR_CONDITION_UN)
+
 /* Weather condition intensity */
 typedef enum avreading_condition_intensity_enum {
 	AVR_CONDITION_ITENSITY_NONE   = 0, /* No intensity information */
@@ -133,19 +177,109 @@ typedef struct avr_struct {
 	avreading_coverage        *rcvrg;  /* The list of cloud layers */
 	avreading_temperature      rtemp;  /* The temperature/dewpoint */
 	float                      raltm;  /* The altimeter reading */
+	unsigned int               rmissing; /* The fields not decoded (AVR_FIELD_*) */
 	struct avr_struct         *next;   /* The next item in the structure */
 } avreading;
 
+/* Table of interned station names, keyed on the packed station code */
+typedef struct av_station_table {
+	uint32_t      *codes;  /* The packed station codes (0 is an empty slot) */
+	char         **names;  /* The interned station names */
+	unsigned int   size;   /* The number of slots in the table (power of 2) */
+	unsigned int   count;  /* The number of stations interned */
+	struct avreading_packed_struct *latest; /* The newest reading of each station */
+	struct avreading_series_struct *series; /* The time series of each station */
+	unsigned int   span;   /* The readings kept per time series (0 if none) */
+	avarena        arena;  /* Memory for the table and names (kept on recycle) */
+} avparser_stations;
+
+/* Types of errors found in the input (one is recorded per bad line) */
+typedef enum avparser_error_enum {
+	AVP_ERROR_SYNTAX      = 0, /* The line is not a valid report */
+	AVP_ERROR_TIME        = 1, /* Bad zulu time */
+	AVP_ERROR_WIND        = 2, /* Bad wind data */
+	AVP_ERROR_VISIBILITY  = 3, /* Bad visibility data */
+	AVP_ERROR_CONDITION   = 4, /* Bad weather condition data */
+	AVP_ERROR_COVERAGE    = 5, /* Bad cloud coverage data */
+	AVP_ERROR_TEMPERATURE = 6, /* Bad temperature data */
+	AVP_ERROR_ALTIMETER   = 7, /* Bad altimeter data */
+	AVP_ERROR_MAX         = 8, /* Guard value */
+} avparser_error_type;
+
+/* A bad (skipped) line of input */
+typedef struct avparser_error_struct {
+	long                          line;   /* The line number (from 1) */
+	avparser_error_type           type;   /* The type of error */
+	char                         *token;  /* The offending token (copy) */
+	struct avparser_error_struct *next;   /* The next error */
+} avparser_error;
+
 /* Structure for holding all of the readings parsed */
 typedef struct av_readings {
-	int         no_readings;  /* The nunber of parsed readings */
-	avreading  *readings;     /* The readings themeselves */
-	avreading  *tail;         /* The last reading in the list */
+	int                no_readings;  /* The nunber of parsed readings */
+	avreading         *readings;     /* The readings themeselves */
+	avreading         *tail;         /* The last reading in the list */
+	int                no_errors;    /* The number of bad lines */
+	avparser_error    *errors;       /* The errors, one per bad line */
+	avparser_error    *etail;        /* The last error in the list */
+	long               no_lines;     /* The number of lines parsed */
+	avarena            arena;        /* Memory for the readings and their contents */
+	avparser_stations  stations;     /* The interned station names */
 } avparser_out;
 
+/* Parsing engines (selectable at runtime, identical output) */
+typedef enum avparser_engine_enum {
+	AVP_ENGINE_GRAMMAR = 0, /* Flex scanner and bison grammar (default) */
+	AVP_ENGINE_DECODER = 1, /* Hand written single pass line decoder */
+} avparser_engine;
+
+/* Streaming callback, called with each complete reading (storage is recycled
+   once the callback returns) */
+typedef void (*avparser_callback)( avreading *avr, void *data );
+
+/* Parser context, holds all of the state for one parse (one per thread) */
+typedef struct av_parser_context {
+	avparser_engine engine;  /* The engine used to parse the input */
+	unsigned int   fields;   /* The fields to decode (AVR_FIELD_*) */
+	unsigned int   span;     /* The readings kept per station series (0 if none) */
+	struct avparser_station_set_struct *include; /* The stations to parse (NULL for all) */
+	struct avparser_dedup_struct *dedup; /* The cache of lines seen (NULL if none) */
+	struct avparser_stats_struct *stats; /* The parse statistics (avstats.h, NULL without AVPARSE_STATS) */
+	unsigned int  *skips;    /* Lines dropped before each line of the block */
+	size_t         nskips;   /* The number of entries in skips */
+	size_t         skipsz;   /* The allocated size of skips */
+	size_t         nextskip; /* The entry of skips for the next line */
+	avparser_out  *avout;    /* The output structure being filled */
+	avreading_timebase timebase; /* The time base for report times */
+	avparser_callback callback; /* The streaming callback (NULL if none) */
+	void          *cbdata;   /* The data passed to the streaming callback */
+	long           streamed; /* The number of readings streamed */
+	long           line;     /* The number of lines finished */
+	long           errors;   /* The number of bad lines */
+	int            badline;  /* Flag indicating the current line is bad */
+	void          *scanner;  /* The reentrant scanner state (yyscan_t) */
+	void          *inbuf;    /* The scanner buffer for the current block */
+	FILE          *in;       /* The file input (NULL for string input) */
+	const char    *metar;    /* The string input not yet read */
+	size_t         metarlen; /* The length of the unread string input */
+	int            eof;      /* Flag indicating the input is exhausted */
+	int            follow;   /* Flag indicating a final partial line is kept (input grows) */
+	char          *map;      /* The mapped file input (NULL if not mapped) */
+	size_t         maplen;   /* The length of the mapped file */
+	size_t         mapoff;   /* The offset of the unread mapped input */
+	char          *buf;      /* The block buffer (scanned in place) */
+	size_t         bufsz;    /* The allocated size of the block buffer */
+	size_t         fill;     /* The number of input bytes in the buffer */
+	char          *block;    /* The block being scanned (buffer or mapping) */
+	size_t         blen;     /* The length of the block being scanned */
+	char           saved[2]; /* Input bytes under the block terminators */
+} avparser_ctx;
+
 /* Static Helper Data */
 extern const char *avr_coverage_strings[]; /* List of cloud coverages */
+extern const char *avparser_error_strings[]; /* List of error reasons */
 extern const char *avr_condition_strings[][2]; /* List of weather conditions */
+extern const unsigned char avr_condition_codes[]; /* Code to condition table */
 
 #define AVPARSE_INCLUDED
 #endif
\ No newline at end of file
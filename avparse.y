@@ -12,23 +12,35 @@
 
 // Includes
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <avparse.h>
 #include <avfldparse.h>
+#include <avstats.h>
 
 // Definitions
 #define YYDEBUG 1 // Enable parsing 
 
-/* Global data */
-avparser_out *avout;
-FILE *yyin;
-
 %}
 
+/* Pure (reentrant) parser, the scanner and context are passed explicitly */
+%define api.pure full
+%lex-param   { yyscan_t scanner }
+%parse-param { yyscan_t scanner }
+%parse-param { avparser_ctx *ctx }
+
+%code requires {
+/* The reentrant scanner handle (matches the flex definition) */
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+}
+
 /* Declare all of the types of parsed values */
 %union {
 	int                   intval;
-	char                 *strval;
+	avparser_token        tokval;
 	avreading            *parsed;
 	avreading_wind       *wndval;
 	avreading_condition  *cndval;
@@ -36,16 +48,16 @@ FILE *yyin;
 }
 
 /* Declare the tokens we will be using */
-%token <strval> AIRPORT
-%token <strval> ZULUTIME
-%token <strval> CORRECTION
-%token <strval> WIND
-%token <strval> WINDGUST
-%token <strval> VISIBILITY
-%token <strval> CONDITION
-%token <strval> COVERAGE
-%token <strval> TEMPERATURE
-%token <strval> ALTIMETER
+%token <tokval> AIRPORT
+%token <tokval> ZULUTIME
+%token <tokval> CORRECTION
+%token <tokval> WIND
+%token <tokval> WINDGUST
+%token <tokval> VISIBILITY
+%token <tokval> CONDITION
+%token <tokval> COVERAGE
+%token <tokval> TEMPERATURE
+%token <tokval> ALTIMETER
 %token <intval> EOL
 %token <intval> UNKNOWN
 
@@ -55,6 +67,12 @@ FILE *yyin;
 %type <cndval> condexpr
 %type <cvgval> covexpr
 
+%code {
+/* Scanner interface (defined in the flex generated code) */
+int yylex( YYSTYPE *lvalp, yyscan_t scanner );
+char *yyget_text( yyscan_t scanner );
+}
+
 %%
 
 avmetar: 
@@ -65,97 +83,157 @@ avmetar:
 avmetar_expression:
 	preamble wind VISIBILITY condexpr covexpr TEMPERATURE ALTIMETER EOL {
 		$$ = $1;
-		$$->rwind = *$2;
-		free($2);
-		$$->rviz = parse_visibility($3);
+		if ( $2 != NULL ) {
+			$$->rwind = *$2;
+		}
 		$$->rcond = $4;
 		$$->rcvrg = $5;
-		parse_temperature($6, &$$->rtemp);
-		$$->raltm = parse_altimeter($7);
+		if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_VISIBILITY) && (AVSTATS_DECODE(ctx->stats, parse_visibility($3, &$$->rviz)) != 0) ) {
+			add_avparser_error(ctx, AVP_ERROR_VISIBILITY, $3);
+		}
+		if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_TEMPERATURE) && (AVSTATS_DECODE(ctx->stats, parse_temperature($6, &$$->rtemp)) != 0) ) {
+			add_avparser_error(ctx, AVP_ERROR_TEMPERATURE, $6);
+		}
+		if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_ALTIMETER) && (AVSTATS_DECODE(ctx->stats, parse_altimeter($7, &$$->raltm)) != 0) ) {
+			add_avparser_error(ctx, AVP_ERROR_ALTIMETER, $7);
+		}
+		complete_avparser_reading(ctx, $$);
 	}
 	|
 	preamble wind VISIBILITY covexpr TEMPERATURE ALTIMETER EOL {
 		$$ = $1;
-		$$->rwind = *$2;
-		free($2);
-		$$->rviz = parse_visibility($3);
+		if ( $2 != NULL ) {
+			$$->rwind = *$2;
+		}
 		$$->rcond = NULL;
 		$$->rcvrg = $4;
-		parse_temperature($5, &$$->rtemp);
-		$$->raltm = parse_altimeter($6);
+		if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_VISIBILITY) && (AVSTATS_DECODE(ctx->stats, parse_visibility($3, &$$->rviz)) != 0) ) {
+			add_avparser_error(ctx, AVP_ERROR_VISIBILITY, $3);
+		}
+		if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_TEMPERATURE) && (AVSTATS_DECODE(ctx->stats, parse_temperature($5, &$$->rtemp)) != 0) ) {
+			add_avparser_error(ctx, AVP_ERROR_TEMPERATURE, $5);
+		}
+		if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_ALTIMETER) && (AVSTATS_DECODE(ctx->stats, parse_altimeter($6, &$$->raltm)) != 0) ) {
+			add_avparser_error(ctx, AVP_ERROR_ALTIMETER, $6);
+		}
+		complete_avparser_reading(ctx, $$);
+	}
+	|
+	error EOL {
+		/* Bad line (recorded by yyerror), skip to the next line */
+		$$ = NULL;
+		complete_avparser_reading(ctx, NULL);
+		yyerrok;
 	}
 	;
 
 preamble:
 	AIRPORT ZULUTIME { 
-		$$ = allocate_avparser_reading(avout);
-		$$->field = $1;
-		parse_zulu_time($2, &$$->rtime);
+		$$ = allocate_avparser_reading(ctx->avout);
+		$$->field = intern_avparser_station(ctx->avout, $1);
+		if ( AVSTATS_DECODE(ctx->stats, parse_zulu_time($2, &$$->rtime, &ctx->timebase)) != 0 ) {
+			add_avparser_error(ctx, AVP_ERROR_TIME, $2);
+		}
 		$$->rcorr = 0; 
 	}
 	|
 	AIRPORT ZULUTIME CORRECTION {
-		$$ = allocate_avparser_reading(avout);
-		$$->field = $1;
-		parse_zulu_time($2, &$$->rtime);
+		$$ = allocate_avparser_reading(ctx->avout);
+		$$->field = intern_avparser_station(ctx->avout, $1);
+		if ( AVSTATS_DECODE(ctx->stats, parse_zulu_time($2, &$$->rtime, &ctx->timebase)) != 0 ) {
+			add_avparser_error(ctx, AVP_ERROR_TIME, $2);
+		}
 		$$->rcorr = 1;
 	}
 
 wind:
 	WIND {
-		$$ = malloc(sizeof(avreading_wind));
-		parse_wind($1, $$, AVP_NO_GUST);
+		$$ = NULL;
+		if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_WIND) ) {
+			$$ = avarena_alloc(&ctx->avout->arena, sizeof(avreading_wind));
+			if ( AVSTATS_DECODE(ctx->stats, parse_wind($1, $$, AVP_NO_GUST)) != 0 ) {
+				add_avparser_error(ctx, AVP_ERROR_WIND, $1);
+			}
+		}
 	}
 	|
 	WINDGUST {
-		$$ = malloc(sizeof(avreading_wind));
-		parse_wind($1, $$, AVP_GUST);
+		$$ = NULL;
+		if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_WIND) ) {
+			$$ = avarena_alloc(&ctx->avout->arena, sizeof(avreading_wind));
+			if ( AVSTATS_DECODE(ctx->stats, parse_wind($1, $$, AVP_GUST)) != 0 ) {
+				add_avparser_error(ctx, AVP_ERROR_WIND, $1);
+			}
+		}
 	}
 	;
 
 condexpr: CONDITION {
-	    $$ = malloc(sizeof(avreading_condition));
-	    $$->next = NULL;
-	    parse_conditions($1, $$);
+	    $$ = NULL;
+	    if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_CONDITIONS) ) {
+		    $$ = avarena_alloc(&ctx->avout->arena, sizeof(avreading_condition));
+		    if ( AVSTATS_DECODE(ctx->stats, parse_conditions($1, $$)) != 0 ) {
+		    	add_avparser_error(ctx, AVP_ERROR_CONDITION, $1);
+		    }
+		    $$->next = NULL;
+	    }
     } 
     |
     condexpr CONDITION {
-	    $$ = malloc(sizeof(avreading_condition));
-	    $$->next = NULL;
-	    parse_conditions($2, $$);
-	    $1->next = $$;
-	    $$ = $1;
+	    avreading_condition *tail = $1;
+	    $$ = NULL;
+	    if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_CONDITIONS) ) {
+		    $$ = avarena_alloc(&ctx->avout->arena, sizeof(avreading_condition));
+		    if ( AVSTATS_DECODE(ctx->stats, parse_conditions($2, $$)) != 0 ) {
+		    	add_avparser_error(ctx, AVP_ERROR_CONDITION, $2);
+		    }
+		    $$->next = NULL;
+		    while ( tail->next != NULL ) {
+		    	tail = tail->next;
+		    }
+		    tail->next = $$;
+		    $$ = $1;
+	    }
     }
     ;
 
 covexpr: COVERAGE {
-		$$ = malloc(sizeof(avreading_coverage));
-		$$->next = NULL;
-		parse_coverage($1, $$);
+		$$ = NULL;
+		if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_COVERAGE) ) {
+			$$ = avarena_alloc(&ctx->avout->arena, sizeof(avreading_coverage));
+			$$->next = NULL;
+			if ( AVSTATS_DECODE(ctx->stats, parse_coverage($1, $$)) != 0 ) {
+				add_avparser_error(ctx, AVP_ERROR_COVERAGE, $1);
+			}
+		}
 	}
 	| covexpr COVERAGE {
-		$$ = malloc(sizeof(avreading_coverage));
-		$$->next = NULL;
-		parse_coverage($2, $$);
-		$1->next = $$;
-		$$ = $1;
+		avreading_coverage *tail = $1;
+		$$ = NULL;
+		if ( AVR_FIELD_WANTED(ctx, AVR_FIELD_COVERAGE) ) {
+			$$ = avarena_alloc(&ctx->avout->arena, sizeof(avreading_coverage));
+			$$->next = NULL;
+			if ( AVSTATS_DECODE(ctx->stats, parse_coverage($2, $$)) != 0 ) {
+				add_avparser_error(ctx, AVP_ERROR_COVERAGE, $2);
+			}
+			while ( tail->next != NULL ) {
+				tail = tail->next;
+			}
+			tail->next = $$;
+			$$ = $1;
+		}
 	}
 	;
 
 %%
 
-void yyerror(char *s) {
-  fprintf(stderr, "error: %s, token [%s]\n", s, yytext);
-}
+void yyerror( yyscan_t scanner, avparser_ctx *ctx, const char *s ) {
 
-void set_avparser_input( FILE *in, char *metar ) {
-
-	// Setup the input for the parser
-	if ( in == NULL ) {
-		yy_scan_string(metar);
-	} else {
-	   	yyin = in;
-	}
+	/* Local variables */
+	avparser_token tok;
 
-	return;
+	/* Record the error against the line, recovery skips the rest of it */
+	tok.str = yyget_text(scanner);
+	tok.len = strlen(tok.str);
+	add_avparser_error(ctx, AVP_ERROR_SYNTAX, tok);
 }
@@ -0,0 +1,181 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avseries.c
+//  Description   : This file contains the per-station time series of the 
+//                  avparse library, each station keeps its newest readings 
+//                  (packed) in a bounded ring ordered on the zulu time.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Fri Dec  6 09:41:17 EST 2019
+*/
+
+/* Includes */
+#include <string.h>
+#include <avparse.h>
+#include <avfldparse.h>
+#include <avpacked.h>
+#include <avseries.h>
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : find_avreading_series
+// Description  : find the first reading of a series at or after a time 
+//                (binary search, readings mostly arrive in time order)
+//
+// Inputs       : ser - the series to search
+//                span - the number of slots in the series ring
+//                zulu - the time to look for (minutes since the epoch)
+// Outputs      : the index of the reading (count if none)
+*/
+
+static unsigned int find_avreading_series( avreading_series *ser, unsigned int span, uint32_t zulu ) {
+
+	/* Local variables */
+	unsigned int lo = 0, hi = ser->count, mid;
+
+	/* Check the newest reading first (the common case), then search */
+	if ( (hi == 0) || (AVR_SERIES_AT(ser, span, hi-1)->zulu < zulu) ) {
+		return( hi );
+	}
+	while ( lo < hi ) {
+		mid = lo + (hi - lo) / 2;
+		if ( AVR_SERIES_AT(ser, span, mid)->zulu < zulu ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return( lo );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : store_avreading_series
+// Description  : add a reading to the time series of its station, dropping
+//                the oldest reading if the series is full (a corrected 
+//                report replaces the reading at the same time, any other
+//                report at the same time is ignored)
+//
+// Inputs       : tbl - the station table (station already interned)
+//                pkd - the (packed) reading
+// Outputs      : none
+*/
+
+void store_avreading_series( avparser_stations *tbl, const avreading_packed *pkd ) {
+
+	/* Local variables */
+	avreading_series *ser;
+	unsigned int pos, i;
+
+	/* Get the series of the station, allocate the ring on first use */
+	ser = &tbl->series[find_avparser_station(tbl->codes, tbl->size, pkd->station)];
+	if ( ser->ring == NULL ) {
+		ser->ring = avarena_alloc( &tbl->arena, tbl->span * sizeof(avreading_packed) );
+		ser->start = ser->count = 0;
+	}
+
+	/* Find the place of the reading, handle a reading at the same time */
+	pos = find_avreading_series( ser, tbl->span, pkd->zulu );
+	if ( (pos < ser->count) && (AVR_SERIES_AT(ser, tbl->span, pos)->zulu == pkd->zulu) ) {
+		if ( pkd->flags & AVR_PACKED_CORRECTED ) {
+			*AVR_SERIES_AT(ser, tbl->span, pos) = *pkd;
+		}
+		return;
+	}
+
+	/* Make room if full (a reading older than all held is dropped) */
+	if ( ser->count == tbl->span ) {
+		if ( pos == 0 ) {
+			return;
+		}
+		ser->start = (ser->start + 1) % tbl->span;
+		ser->count --;
+		pos --;
+	}
+
+	/* Move any newer readings up, insert the reading */
+	for ( i = ser->count; i > pos; i -- ) {
+		*AVR_SERIES_AT(ser, tbl->span, i) = *AVR_SERIES_AT(ser, tbl->span, i-1);
+	}
+	*AVR_SERIES_AT(ser, tbl->span, pos) = *pkd;
+	ser->count ++;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : enable_avreading_series
+// Description  : keep a time series for each station of the output, holding
+//                at most span readings per station (readings already in the
+//                output are added, later readings are added as parsed)
+//
+// Inputs       : avout - parser output structure
+//                span - the number of readings to keep per station
+// Outputs      : 0 if successful, -1 if the series are already kept
+*/
+
+int enable_avreading_series( avparser_out *avout, unsigned int span ) {
+
+	/* Local variables */
+	avreading *avr;
+
+	/* Check the series can be (re)sized */
+	if ( (avout->stations.span != 0) || (span == 0) ) {
+		return( -1 );
+	}
+
+	/* Set the span, then add the readings already parsed */
+	avout->stations.span = span;
+	for ( avr = avout->readings; avr != NULL; avr = avr->next ) {
+		update_avparser_latest( avout, avr );
+	}
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : query_avreading_series
+// Description  : get the readings of a station in a time range (inclusive)
+//
+// Inputs       : avout - parser output structure
+//                station - the station (4 letter) code
+//                from - the start of the range (zulu time)
+//                to - the end of the range (zulu time)
+//                out - the array to copy the readings to (oldest first)
+//                max - the number of readings the array holds
+// Outputs      : the number of readings in the range (at most max copied)
+*/
+
+unsigned int query_avreading_series( avparser_out *avout, const char *station, time_t from, time_t to, 
+									 avreading_packed *out, unsigned int max ) {
+
+	/* Local variables */
+	avparser_stations *tbl = &avout->stations;
+	avreading_series *ser;
+	unsigned int idx, pos, i;
+	uint32_t zfrom, zto;
+
+	/* Find the series of the station */
+	if ( (tbl->size == 0) || (tbl->span == 0) || (to < from) || (to < 0) || ((from + 59) / 60 > UINT32_MAX) ||
+		 (strnlen(station, AVR_STATION_LEN + 1) != AVR_STATION_LEN) ) {
+		return( 0 );
+	}
+	idx = find_avparser_station( tbl->codes, tbl->size, AVR_STATION_CODE(station) );
+	ser = &tbl->series[idx];
+	if ( (tbl->codes[idx] == 0) || (ser->ring == NULL) ) {
+		return( 0 );
+	}
+
+	/* Search for the start of the range (whole minutes), copy the readings */
+	zfrom = (from <= 0) ? 0 : (uint32_t)((from + 59) / 60);
+	zto = (to / 60 > UINT32_MAX) ? UINT32_MAX : (uint32_t)(to / 60);
+	pos = find_avreading_series( ser, tbl->span, zfrom );
+	for ( i = 0; (pos + i < ser->count) && (AVR_SERIES_AT(ser, tbl->span, pos+i)->zulu <= zto); i ++ ) {
+		if ( i < max ) {
+			out[i] = *AVR_SERIES_AT(ser, tbl->span, pos+i);
+		}
+	}
+	return( i );
+}
@@ -0,0 +1,34 @@
+#ifndef AVSERIES_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avseries.h
+//  Description   : This file contains the definitions for the per-station
+//                  time series (bounded ring buffers of readings) of the 
+//                  avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Fri Dec  6 09:41:17 EST 2019
+*/
+
+/** Include Files **/
+#include <time.h>
+#include <avparse.h>
+#include <avpacked.h>
+
+/* The time series of one station, the newest readings in time order */
+typedef struct avreading_series_struct {
+	avreading_packed *ring;   /* The ring of readings (NULL until first used) */
+	unsigned int      start;  /* The slot of the oldest reading */
+	unsigned int      count;  /* The number of readings held */
+} avreading_series;
+
+/* Reading i (0 is the oldest) of a series with span slots */
+#define AVR_SERIES_AT(ser, span, i) (&(ser)->ring[((ser)->start + (i)) % (span)])
+
+/** Functional Prototypes **/
+int                   enable_avreading_series( avparser_out *avout, unsigned int span );
+void                  store_avreading_series( avparser_stations *tbl, const avreading_packed *pkd );
+unsigned int          query_avreading_series( avparser_out *avout, const char *station, time_t from, time_t to, avreading_packed *out, unsigned int max );
+
+#define AVSERIES_INCLUDED
+#endif
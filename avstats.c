@@ -0,0 +1,320 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avstats.c
+//  Description   : This file contains the parse instrumentation of the avparse
+//                  library, the statistics kept in the parser context are
+//                  queried, reset, merged and printed here (the counters are
+//                  only updated when compiled with AVPARSE_STATS).
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Fri Dec 20 10:48:13 EST 2019
+*/
+
+/* Includes */
+#include <string.h>
+#include <avparse.h>
+#include <avfilter.h>
+#include <avdedup.h>
+#include <avstats.h>
+
+/* Definitions */
+_Static_assert( (AVSTATS_SAMPLE > 0) && ((AVSTATS_SAMPLE & (AVSTATS_SAMPLE-1)) == 0), 
+				"the stats sample must be a power of 2" );
+
+/* Local data */
+
+/* Names of the token types (by AVS_TOKEN_*) */
+static const char *avstats_token_strings[] = {
+	"Airport", "Zulu time", "Correction", "Visibility", "Wind", "Wind gust",
+	"Condition", "Coverage", "Temperature", "Altimeter", "End of line", "Unknown"
+};
+
+/* Names of the timed sections (by AVS_TIMER_*) */
+static const char *avstats_timer_strings[] = {
+	"Lexing", "Field decoding", "Output"
+};
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avparser_stats_enabled
+// Description  : check if the library was compiled with the instrumentation
+//
+// Inputs       : none
+// Outputs      : 1 if the statistics are kept, 0 if not
+*/
+
+int avparser_stats_enabled( void ) {
+#ifdef AVPARSE_STATS
+	return( 1 );
+#else
+	return( 0 );
+#endif
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : get_avparser_stats
+// Description  : get (a copy of) the statistics of a parser context, the
+//                lines filtered and skipped as repeats are taken from the
+//                station filter and repeat cache of the context
+//
+// Inputs       : ctx - the parser context
+//                stats - the statistics to fill in
+// Outputs      : 0 if successful, -1 if the statistics are not compiled in
+//                (stats is zeroed)
+*/
+
+int get_avparser_stats( avparser_ctx *ctx, avparser_stats *stats ) {
+
+	/* Copy the counters, add the filter and cache counts */
+	if ( ctx->stats == NULL ) {
+		memset( stats, 0x0, sizeof(avparser_stats) );
+		return( -1 );
+	}
+	*stats = *ctx->stats;
+	if ( ctx->include != NULL ) {
+		stats->filtered = ctx->include->dropped;
+	}
+	if ( ctx->dedup != NULL ) {
+		stats->repeated = ctx->dedup->hits;
+	}
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : reset_avparser_stats
+// Description  : clear the statistics of a parser context
+//
+// Inputs       : ctx - the parser context
+// Outputs      : none
+*/
+
+void reset_avparser_stats( avparser_ctx *ctx ) {
+
+	/* Local variables */
+	unsigned int sample;
+
+	/* Zero the counters, timers and histogram (keep the sampling) */
+	if ( ctx->stats != NULL ) {
+		sample = ctx->stats->sample;
+		memset( ctx->stats, 0x0, sizeof(avparser_stats) );
+		ctx->stats->sample = sample;
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_avparser_stats_sample
+// Description  : set how many lines (and readings written) there are per one
+//                timed, 1 times every line (the cycle counter is then read
+//                around every token)
+//
+// Inputs       : ctx - the parser context
+//                sample - the lines per one timed (a power of 2)
+// Outputs      : 0 if successful, -1 if the sample is not a power of 2 or
+//                the statistics are not compiled in
+*/
+
+int set_avparser_stats_sample( avparser_ctx *ctx, unsigned int sample ) {
+
+	/* Check the sample, set it */
+	if ( (ctx->stats == NULL) || (sample == 0) || ((sample & (sample-1)) != 0) ) {
+		return( -1 );
+	}
+	ctx->stats->sample = sample;
+	return( 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : merge_avparser_stats
+// Description  : add statistics to others (e.g., those of several contexts)
+//
+// Inputs       : into - the statistics to add to
+//                from - the statistics to add
+// Outputs      : none
+*/
+
+void merge_avparser_stats( avparser_stats *into, const avparser_stats *from ) {
+
+	/* Local variables */
+	int i;
+
+	/* Add each of the counters (the sampling is that of the first added) */
+	if ( into->sample == 0 ) {
+		into->sample = from->sample;
+	}
+	into->lines += from->lines;
+	into->readings += from->readings;
+	into->bytes += from->bytes;
+	into->sampled += from->sampled;
+	into->written += from->written;
+	into->filtered += from->filtered;
+	into->repeated += from->repeated;
+	for ( i = 0; i < AVP_ERROR_MAX; i ++ ) {
+		into->rejected[i] += from->rejected[i];
+	}
+	for ( i = 0; i < AVS_TOKEN_MAX; i ++ ) {
+		into->tokens[i] += from->tokens[i];
+	}
+	for ( i = 0; i < AVS_TIMER_MAX; i ++ ) {
+		into->cycles[i] += from->cycles[i];
+		into->timed[i] += from->timed[i];
+	}
+	for ( i = 0; i < AVSTATS_BUCKETS; i ++ ) {
+		into->latency[i] += from->latency[i];
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : record_avparser_line
+// Description  : count a finished line, the cycles of a timed line are added
+//                to the latency histogram if it produced a reading (and the
+//                next line is timed if it is the next sample)
+//
+// Inputs       : stats - the statistics of the parse
+//                reading - flag indicating the line produced a reading
+// Outputs      : none
+*/
+
+void record_avparser_line( avparser_stats *stats, int reading ) {
+
+	/* Local variables */
+	uint64_t cycles;
+	int bucket = 0;
+
+	/* Count the line, bucket a timed reading by the log2 of its cycles */
+	stats->lines ++;
+	stats->readings += (reading != 0);
+	if ( stats->timing ) {
+		stats->sampled ++;
+		if ( reading ) {
+			for ( cycles = read_avparser_cycles() - stats->start; cycles > 1; cycles >>= 1 ) {
+				bucket ++;
+			}
+			stats->latency[(bucket < AVSTATS_BUCKETS) ? bucket : AVSTATS_BUCKETS-1] ++;
+		}
+	}
+
+	/* Time the next line if it is sampled */
+	if ( (stats->timing = ((stats->lines & (stats->sample-1)) == 0)) ) {
+		stats->start = read_avparser_cycles();
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avstats_percentile
+// Description  : find the (bucket upper bound of the) latency percentile
+//
+// Inputs       : stats - the statistics
+//                count - the number of readings in the histogram
+//                pct - the percentile to find (0-100)
+// Outputs      : the upper bound in cycles of the bucket holding it
+*/
+
+static uint64_t avstats_percentile( const avparser_stats *stats, unsigned long count, double pct ) {
+
+	/* Local variables */
+	unsigned long seen = 0, want;
+	int i;
+
+	/* Walk the buckets until the count is reached */
+	want = (unsigned long)((double)count * pct / 100.0);
+	for ( i = 0; i < AVSTATS_BUCKETS-1; i ++ ) {
+		seen += stats->latency[i];
+		if ( (seen > 0) && (seen >= want) ) {
+			break;
+		}
+	}
+	return( (uint64_t)2 << i );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : print_avparser_stats
+// Description  : print a summary of the statistics of a parse (the counts,
+//                the time in each section and the latency histogram)
+//
+// Inputs       : stats - the statistics to print
+//                out - the file to print to
+// Outputs      : none
+*/
+
+void print_avparser_stats( const avparser_stats *stats, FILE *out ) {
+
+	/* Local variables */
+	unsigned long rejected = 0, tokens = 0, count = 0, peak = 0;
+	double per[AVS_TIMER_MAX], total = 0.0;
+	int i, lo, hi;
+
+	/* The line counts and rejections (by reason) */
+	for ( i = 0; i < AVP_ERROR_MAX; i ++ ) {
+		rejected += stats->rejected[i];
+	}
+	fprintf( out, "Lines: %lu parsed, %lu readings, %lu rejected, %lu filtered, %lu repeated.\n",
+		stats->lines, stats->readings, rejected, stats->filtered, stats->repeated );
+	fprintf( out, "Bytes: %lu (%.1f per line).\n", stats->bytes,
+		(stats->lines) ? (double)stats->bytes / stats->lines : 0.0 );
+	for ( i = 0; i < AVP_ERROR_MAX; i ++ ) {
+		if ( stats->rejected[i] ) {
+			fprintf( out, "  %-22s %10lu\n", avparser_error_strings[i], stats->rejected[i] );
+		}
+	}
+
+	/* The tokens (by type) */
+	for ( i = 0; i < AVS_TOKEN_MAX; i ++ ) {
+		tokens += stats->tokens[i];
+	}
+	fprintf( out, "Tokens: %lu (%.1f per line).\n", tokens,
+		(stats->lines) ? (double)tokens / stats->lines : 0.0 );
+	for ( i = 0; i < AVS_TOKEN_MAX; i ++ ) {
+		if ( stats->tokens[i] ) {
+			fprintf( out, "  %-22s %10lu\n", avstats_token_strings[i], stats->tokens[i] );
+		}
+	}
+
+	/* The cycles of each section (per call, and per line parsed or reading
+	   written) in the timed sample */
+	for ( i = 0; i < AVS_TIMER_MAX; i ++ ) {
+		per[i] = (i == AVS_TIMER_OUTPUT) ? stats->timed[i] : stats->sampled;
+		per[i] = (per[i]) ? (double)stats->cycles[i] / per[i] : 0.0;
+		total += per[i];
+	}
+	fprintf( out, "Cycles: %.1f per line (%lu lines, %lu readings written timed, 1 in %u).\n",
+		total, stats->sampled, stats->timed[AVS_TIMER_OUTPUT], stats->sample );
+	for ( i = 0; i < AVS_TIMER_MAX; i ++ ) {
+		fprintf( out, "  %-22s %10.1f %5.1f%% %10lu calls %10.1f/call\n",
+			avstats_timer_strings[i], per[i], (total > 0) ? 100.0 * per[i] / total : 0.0,
+			stats->timed[i], (stats->timed[i]) ? (double)stats->cycles[i] / stats->timed[i] : 0.0 );
+	}
+
+	/* The latency histogram of the timed readings (the occupied buckets, of
+	   the lines sampled only) */
+	for ( i = 0; i < AVSTATS_BUCKETS; i ++ ) {
+		count += stats->latency[i];
+		peak = (stats->latency[i] > peak) ? stats->latency[i] : peak;
+	}
+	if ( count == 0 ) {
+		return;
+	}
+	for ( lo = 0; stats->latency[lo] == 0; lo ++ );
+	for ( hi = AVSTATS_BUCKETS-1; stats->latency[hi] == 0; hi -- );
+	fprintf( out, "Latency: cycles per reading (%lu timed, 1 in %u lines), p50 < %llu, p90 < %llu, p99 < %llu.\n",
+		count, stats->sample, (unsigned long long)avstats_percentile(stats, count, 50.0),
+		(unsigned long long)avstats_percentile(stats, count, 90.0),
+		(unsigned long long)avstats_percentile(stats, count, 99.0) );
+	for ( i = lo; i <= hi; i ++ ) {
+		fprintf( out, "  < %-20llu %10lu %5.1f%% |%.*s\n", (unsigned long long)2 << i,
+			stats->latency[i], 100.0 * stats->latency[i] / count,
+			(int)(40 * stats->latency[i] / peak), "########################################" );
+	}
+	return;
+}
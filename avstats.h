@@ -0,0 +1,123 @@
+#ifndef AVSTATS_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avstats.h
+//  Description   : This file contains the definitions for the parse
+//                  instrumentation of the avparse library, counters, cycle
+//                  timers and latency histograms kept in the parser context
+//                  (the updates compile to nothing unless AVPARSE_STATS is
+//                  defined).
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Fri Dec 20 10:48:13 EST 2019
+*/
+
+/** Include Files **/
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <avparse.h>
+
+/** Definitions and Types **/
+#define AVSTATS_BUCKETS 48 /* Latency buckets (log2 of the cycles) */
+#ifndef AVSTATS_SAMPLE
+#define AVSTATS_SAMPLE  64 /* Default lines (readings written) per one timed (power of 2) */
+#endif
+
+/* Token types counted (the scanner tokens, in the decoder order) */
+typedef enum avparser_stats_token_enum {
+	AVS_TOKEN_AIRPORT     = 0,  /* Station (airfield) code */
+	AVS_TOKEN_ZULUTIME    = 1,  /* Day and zulu time of the report */
+	AVS_TOKEN_CORRECTION  = 2,  /* Corrected report marker */
+	AVS_TOKEN_VISIBILITY  = 3,  /* Visibility */
+	AVS_TOKEN_WIND        = 4,  /* Wind */
+	AVS_TOKEN_WINDGUST    = 5,  /* Wind with gusts */
+	AVS_TOKEN_CONDITION   = 6,  /* Weather conditions */
+	AVS_TOKEN_COVERAGE    = 7,  /* Cloud layer */
+	AVS_TOKEN_TEMPERATURE = 8,  /* Temperature/dewpoint */
+	AVS_TOKEN_ALTIMETER   = 9,  /* Altimeter setting */
+	AVS_TOKEN_EOL         = 10, /* End of the line */
+	AVS_TOKEN_UNKNOWN     = 11, /* Anything else */
+	AVS_TOKEN_MAX         = 12, /* Guard value */
+} avparser_stats_token;
+
+/* The timed sections of the parse */
+typedef enum avparser_stats_timer_enum {
+	AVS_TIMER_LEX    = 0, /* Scanning the tokens */
+	AVS_TIMER_DECODE = 1, /* Decoding the fields (parse_*) */
+	AVS_TIMER_OUTPUT = 2, /* Writing the readings */
+	AVS_TIMER_MAX    = 3, /* Guard value */
+} avparser_stats_timer;
+
+/* The statistics of a parser context (kept across parses until reset), the
+   counts are exact, the timers and latencies are sampled (one line, or
+   reading written, in sample is timed) */
+typedef struct avparser_stats_struct {
+	unsigned long  lines;     /* The lines parsed */
+	unsigned long  readings;  /* The readings produced */
+	unsigned long  bytes;     /* The bytes of input consumed */
+	unsigned long  rejected[AVP_ERROR_MAX]; /* The bad lines, by reason */
+	unsigned long  filtered;  /* The lines of other stations dropped */
+	unsigned long  repeated;  /* The repeated lines skipped */
+	unsigned long  tokens[AVS_TOKEN_MAX];   /* The tokens, by type */
+	uint64_t       cycles[AVS_TIMER_MAX];   /* The cycles in each section (timed) */
+	unsigned long  timed[AVS_TIMER_MAX];    /* The times each was timed */
+	unsigned long  sampled;   /* The lines timed */
+	unsigned long  written;   /* The readings written */
+	unsigned long  latency[AVSTATS_BUCKETS]; /* Timed readings by log2 of cycles */
+	uint64_t       start;     /* The cycle count the current line started at */
+	int            timing;    /* Flag indicating the current line is timed */
+	unsigned int   sample;    /* Lines (readings written) per one timed (power of 2) */
+} avparser_stats;
+
+/* Read the cycle counter (the time stamp counter where there is one) */
+static inline uint64_t read_avparser_cycles( void ) {
+#if defined(__x86_64__) || defined(__i386__)
+	return( __rdtsc() );
+#elif defined(__aarch64__)
+	uint64_t val;
+	__asm__ __volatile__( "mrs %0, cntvct_el0" : "=r" (val) );
+	return( val );
+#else
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return( (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+#endif
+}
+
+/* Instrumentation updates (nothing unless compiled with AVPARSE_STATS) */
+#ifdef AVPARSE_STATS
+#define AVSTATS_COUNT(st, field) ((st)->field ++)
+#define AVSTATS_BLOCK(st, len) { (st)->bytes += (len); AVSTATS_RESTART(st); }
+#define AVSTATS_LINE(st, ok) record_avparser_line( st, ok )
+#define AVSTATS_RESTART(st) { if ( (st)->timing ) (st)->start = read_avparser_cycles(); }
+#define AVSTATS_START(st, var) uint64_t var = ((st)->timing) ? read_avparser_cycles() : 0
+#define AVSTATS_STOP(st, timer, var) { if ( (st)->timing ) { \
+                                           (st)->cycles[timer] += read_avparser_cycles() - (var); \
+                                           (st)->timed[timer] ++; } }
+#define AVSTATS_DECODE(st, call) ({ AVSTATS_START(st, avs_start_); __typeof__(call) avs_ret_ = (call); \
+                                    AVSTATS_STOP(st, AVS_TIMER_DECODE, avs_start_); avs_ret_; })
+#else
+#define AVSTATS_COUNT(st, field)
+#define AVSTATS_BLOCK(st, len)
+#define AVSTATS_LINE(st, ok)
+#define AVSTATS_RESTART(st)
+#define AVSTATS_START(st, var)
+#define AVSTATS_STOP(st, timer, var)
+#define AVSTATS_DECODE(st, call) (call)
+#endif
+
+/** Functional Prototypes **/
+int                   avparser_stats_enabled( void );
+int                   get_avparser_stats( avparser_ctx *ctx, avparser_stats *stats );
+void                  reset_avparser_stats( avparser_ctx *ctx );
+int                   set_avparser_stats_sample( avparser_ctx *ctx, unsigned int sample );
+void                  merge_avparser_stats( avparser_stats *into, const avparser_stats *from );
+void                  record_avparser_line( avparser_stats *stats, int reading );
+void                  print_avparser_stats( const avparser_stats *stats, FILE *out );
+
+#define AVSTATS_INCLUDED
+#endif
@@ -0,0 +1,172 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avthread.c
+//  Description   : This file contains the multi-threaded parsing code for the
+//                  avparse library.  The input is split into chunks on line
+//                  boundaries, each chunk is parsed by its own worker (with
+//                  its own context and output), and the outputs are joined
+//                  in input order.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Tue Nov 26 11:20:53 EST 2019
+*/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <avparse.h>
+#include <avfldparse.h>
+#include <avthread.h>
+
+/* Types */
+
+/* A chunk of the input, and the worker parsing it */
+typedef struct avthread_chunk_struct {
+	avparser_engine engine;  /* The engine to parse with */
+	const char     *data;    /* The start of the chunk */
+	size_t          len;     /* The length of the chunk */
+	avparser_out   *out;     /* The parsed chunk */
+	pthread_t       thread;  /* The worker thread */
+} avthread_chunk;
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avthread_worker
+// Description  : parse one chunk of the input (worker thread body)
+//
+// Inputs       : arg - the chunk to parse
+// Outputs      : NULL
+*/
+
+static void * avthread_worker( void *arg ) {
+
+	/* Local variables */
+	avthread_chunk *chunk = arg;
+	avparser_ctx *ctx;
+
+	/* Parse the chunk with a private context */
+	ctx = allocate_avparser_ctx();
+	ctx->engine = chunk->engine;
+	chunk->out = avreading_metar_parse_region( ctx, chunk->data, chunk->len );
+	release_avparser_ctx( ctx );
+	return( NULL );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avreading_metar_parse_chunks
+// Description  : parse a region of memory holding METARs with several 
+//                threads, the readings are returned in input order
+//
+// Inputs       : engine - the engine to parse with
+//                data - the start of the region
+//                len - the length of the region
+//                threads - the number of threads to parse with
+// Outputs      : a pointer to the avreading structure
+*/
+
+avparser_out * avreading_metar_parse_chunks( avparser_engine engine, const char *data, size_t len, int threads ) {
+
+	/* Local variables */
+	avthread_chunk *chunks;
+	avparser_out *out;
+	const char *eol;
+	size_t start, end;
+	int i;
+
+	/* Setup the chunks, each ends on a line boundary */
+	threads = (threads < 1) ? 1 : threads;
+	if ( (chunks = malloc(sizeof(avthread_chunk) * threads)) == NULL ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	start = 0;
+	for ( i = 0; i < threads; i ++ ) {
+		end = (i == threads - 1) ? len : (len / threads) * (i + 1);
+		if ( end < start ) {
+			end = start;
+		} else if ( (end > start) && (end < len) && (data[end-1] != '\n') ) {
+			eol = memchr( data + end, '\n', len - end );
+			end = (eol == NULL) ? len : (size_t)(eol - data) + 1;
+		}
+		chunks[i].engine = engine;
+		chunks[i].data = data + start;
+		chunks[i].len = end - start;
+		chunks[i].out = NULL;
+		start = end;
+	}
+
+	/* Parse the chunks in parallel (the first in this thread) */
+	for ( i = 1; i < threads; i ++ ) {
+		if ( pthread_create(&chunks[i].thread, NULL, avthread_worker, &chunks[i]) != 0 ) {
+			AVPARSE_FATAL_ERROR("Worker thread creation failed, aborting");
+			exit(-1);
+		}
+	}
+	avthread_worker( &chunks[0] );
+
+	/* Join the workers, append their readings in order */
+	out = chunks[0].out;
+	for ( i = 1; i < threads; i ++ ) {
+		pthread_join( chunks[i].thread, NULL );
+		append_avparser_struct( out, chunks[i].out );
+	}
+
+	/* Cleanup, return the joined output */
+	free( chunks );
+	return( out );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : avreading_metar_parse_threads
+// Description  : parse a file of METARs with several threads (the file is 
+//                memory mapped and split into chunks)
+//
+// Inputs       : engine - the engine to parse with
+//                path - the path of the file to parse
+//                threads - the number of threads to parse with
+// Outputs      : a pointer to the avreading structure, NULL if the file
+//                could not be mapped
+*/
+
+avparser_out * avreading_metar_parse_threads( avparser_engine engine, const char *path, int threads ) {
+
+	/* Local variables */
+	avparser_out *out;
+	struct stat st;
+	char *map = NULL;
+	int fd;
+
+	/* Open the file, get the size and map it (read only) */
+	if ( (fd = open(path, O_RDONLY)) == -1 ) {
+		return( NULL );
+	}
+	if ( fstat(fd, &st) == -1 ) {
+		close( fd );
+		return( NULL );
+	}
+	if ( st.st_size > 0 ) {
+		map = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( map == MAP_FAILED ) {
+			close( fd );
+			return( NULL );
+		}
+		madvise( map, st.st_size, MADV_WILLNEED );
+	}
+	close( fd );
+
+	/* Parse the chunks, release the mapping */
+	out = avreading_metar_parse_chunks( engine, (map == NULL) ? "" : map, st.st_size, threads );
+	if ( map != NULL ) {
+		munmap( map, st.st_size );
+	}
+	return( out );
+}
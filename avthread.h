@@ -0,0 +1,21 @@
+#ifndef AVTHREAD_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avthread.h
+//  Description   : This file contains the definitions for the multi-threaded
+//                  (chunked) parsing of the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Tue Nov 26 11:20:53 EST 2019
+*/
+
+/** Include Files **/
+#include <stddef.h>
+#include <avparse.h>
+
+/** Functional Prototypes **/
+avparser_out *        avreading_metar_parse_chunks( avparser_engine engine, const char *data, size_t len, int threads );
+avparser_out *        avreading_metar_parse_threads( avparser_engine engine, const char *path, int threads );
+
+#define AVTHREAD_INCLUDED
+#endif
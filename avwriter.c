@@ -0,0 +1,932 @@
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avwriter.c
+//  Description   : This file contains the buffered text output writer of the
+//                  avparse library, text is appended to a growable buffer 
+//                  (numbers are formatted directly) and flushed to the file
+//                  or descriptor in large blocks.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Fri Dec 13 09:12:05 EST 2019
+*/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <avparse.h>
+#include <avfldparse.h>
+#include <avwriter.h>
+#include <avstats.h>
+
+/* Definitions */
+static const char *avw_day_names[] = { "Sunday", "Monday", "Tuesday", "Wednesday",
+	"Thursday", "Friday", "Saturday" };
+static const char *avw_month_names[] = { "January", "February", "March", "April", 
+	"May", "June", "July", "August", "September", "October", "November", "December" };
+static const char *avw_coverage_codes[] = { "SKC", "FEW", "SCT", "BKN", "OVC", "UNK" };
+static const char *avw_intensity_names[] = { "none", "light", "heavy" };
+#define AVW_CSV_HEADER "station,zulu,local,corrected,wind_direction,wind_speed,wind_gust," \
+	"visibility,conditions,layers,temperature,dewpoint,temperature_f,dewpoint_f,altimeter\n"
+#define AVW_MISSING(avr, f) (((avr)->rmissing & (f)) != 0)
+#define AVW_CONDITION_OK(cond) ((cond)->intensity <= AVR_CONDITION_ITENSITY_HEAVY)
+#define AVW_COVERAGE_CODE(cvg) avw_coverage_codes[((cvg)->coverage > AVR_OVERCAST) ? AVR_UNKNOWN : (cvg)->coverage]
+
+/* Functions */
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : allocate_avparser_writer
+// Description  : allocate a writer flushing to a file or descriptor (if the
+//                file is NULL and fd is -1 the output is kept in memory)
+//
+// Inputs       : file - the file to flush to (NULL if none)
+//                fd - the descriptor to flush to (-1 if none)
+// Outputs      : a pointer to the new writer
+*/
+
+avparser_writer * allocate_avparser_writer( FILE *file, int fd ) {
+
+	/* Local variables */
+	avparser_writer *wr;
+	size_t size = ((file == NULL) && (fd == -1)) ? AVPARSE_WRITER_MEMORY : AVPARSE_WRITER_BLOCK;
+
+	/* Allocate the writer and its buffer (small for memory, it is grown) */
+	if ( ((wr = malloc(sizeof(avparser_writer))) == NULL) ||
+		 ((wr->buf = malloc(size)) == NULL) ) {
+		AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+		exit(-1);
+	}
+	wr->len = 0;
+	wr->size = size;
+	wr->file = file;
+	wr->fd = (file == NULL) ? fd : -1;
+	wr->error = 0;
+	wr->fixed = 0;
+	wr->format = AVP_FORMAT_TEXT;
+	wr->header = 0;
+	wr->tlen[0] = wr->tlen[1] = 0;
+	wr->stats = NULL;
+	return( wr );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : fixed_avparser_writer
+// Description  : setup a writer (of the caller) writing into a fixed buffer,
+//                output past the end is dropped and room is kept for the
+//                terminator (nothing is allocated, it is not released)
+//
+// Inputs       : wr - the writer to setup
+//                buf - the buffer to write into
+//                size - the size of the buffer (at least 1)
+// Outputs      : none
+*/
+
+void fixed_avparser_writer( avparser_writer *wr, char *buf, size_t size ) {
+
+	/* Setup the writer over the buffer */
+	memset( wr, 0x0, sizeof(avparser_writer) );
+	wr->buf = buf;
+	wr->size = size - 1;
+	wr->fd = -1;
+	wr->fixed = 1;
+	wr->format = AVP_FORMAT_TEXT;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : flush_avparser_writer
+// Description  : write out the buffered output (nothing for memory writers)
+//
+// Inputs       : wr - the writer
+// Outputs      : 0 if successful, -1 if the output could not be written
+*/
+
+int flush_avparser_writer( avparser_writer *wr ) {
+
+	/* Local variables */
+	size_t off = 0;
+	ssize_t ret;
+
+	/* Write to the file, or the descriptor (until all written) */
+	if ( wr->file != NULL ) {
+		if ( (wr->len > 0) && (fwrite(wr->buf, 1, wr->len, wr->file) != wr->len) ) {
+			wr->error = 1;
+		}
+		wr->len = 0;
+	} else if ( wr->fd != -1 ) {
+		while ( off < wr->len ) {
+			if ( (ret = write(wr->fd, wr->buf + off, wr->len - off)) < 0 ) {
+				if ( errno == EINTR ) {
+					continue;
+				}
+				wr->error = 1;
+				break;
+			}
+			off += ret;
+		}
+		wr->len = 0;
+	}
+	return( (wr->error) ? -1 : 0 );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : release_avparser_writer
+// Description  : flush and release a writer
+//
+// Inputs       : wr - the writer
+// Outputs      : 0 if successful, -1 if the output could not be written
+*/
+
+int release_avparser_writer( avparser_writer *wr ) {
+
+	/* Local variables */
+	int ret;
+
+	/* Flush, then free the buffer and writer */
+	ret = flush_avparser_writer( wr );
+	if ( wr->file != NULL ) {
+		fflush( wr->file );
+	}
+	free( wr->buf );
+	free( wr );
+	return( ret );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : detach_avparser_writer
+// Description  : release a memory writer, keeping its output (the buffer is
+//                shrunk to the output)
+//
+// Inputs       : wr - the (memory) writer
+// Outputs      : the output (a string the caller frees)
+*/
+
+char * detach_avparser_writer( avparser_writer *wr ) {
+
+	/* Local variables */
+	char *str;
+
+	/* Terminate the output, shrink it, free the writer */
+	write_avparser_chars( wr, 0x0, 1 );
+	if ( (str = realloc(wr->buf, wr->len)) == NULL ) {
+		str = wr->buf;
+	}
+	free( wr );
+	return( str );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : reserve_avparser_writer
+// Description  : make room in the buffer (flushing, or growing it), a fixed
+//                buffer is not grown (the length is cut to the room left)
+//
+// Inputs       : wr - the writer
+//                len - the number of bytes to make room for (cut if fixed)
+// Outputs      : a pointer to the free space in the buffer
+*/
+
+static char * reserve_avparser_writer( avparser_writer *wr, size_t *len ) {
+
+	/* Local variables */
+	size_t size = wr->size;
+
+	/* Flush a full buffer, grow it if it is still too small */
+	if ( wr->fixed ) {
+		if ( wr->len + *len > wr->size ) {
+			*len = wr->size - wr->len;
+		}
+	} else if ( wr->len + *len > wr->size ) {
+		flush_avparser_writer( wr );
+		while ( wr->len + *len > size ) {
+			size *= 2;
+		}
+		if ( size != wr->size ) {
+			if ( (wr->buf = realloc(wr->buf, size)) == NULL ) {
+				AVPARSE_FATAL_ERROR("Memory allocation failed, aborting");
+				exit(-1);
+			}
+			wr->size = size;
+		}
+	}
+	return( wr->buf + wr->len );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_str
+// Description  : write a string of known length
+//
+// Inputs       : wr - the writer
+//                str - the string to write
+//                len - the length of the string
+// Outputs      : none
+*/
+
+void write_avparser_str( avparser_writer *wr, const char *str, size_t len ) {
+
+	/* Local variables */
+	char *ptr = reserve_avparser_writer( wr, &len );
+
+	/* Copy into the buffer */
+	memcpy( ptr, str, len );
+	wr->len += len;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_cstr
+// Description  : write a (terminated) string
+//
+// Inputs       : wr - the writer
+//                str - the string to write
+// Outputs      : none
+*/
+
+void write_avparser_cstr( avparser_writer *wr, const char *str ) {
+
+	/* Write the string (without the terminator) */
+	write_avparser_str( wr, str, strlen(str) );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_chars
+// Description  : write a character a number of times (e.g., indentation)
+//
+// Inputs       : wr - the writer
+//                ch - the character to write
+//                count - the number of times to write it
+// Outputs      : none
+*/
+
+void write_avparser_chars( avparser_writer *wr, char ch, size_t count ) {
+
+	/* Local variables */
+	char *ptr = reserve_avparser_writer( wr, &count );
+
+	/* Fill in the characters */
+	memset( ptr, ch, count );
+	wr->len += count;
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_int
+// Description  : write an integer (in decimal)
+//
+// Inputs       : wr - the writer
+//                val - the value to write
+// Outputs      : none
+*/
+
+void write_avparser_int( avparser_writer *wr, long val ) {
+
+	/* Local variables */
+	char digits[24], *ptr = digits + sizeof(digits);
+	unsigned long uval = (val < 0) ? -(unsigned long)val : (unsigned long)val;
+
+	/* Fill in the digits from the end, then the sign */
+	do {
+		*--ptr = (char)('0' + (uval % 10));
+		uval /= 10;
+	} while ( uval != 0 );
+	if ( val < 0 ) {
+		*--ptr = '-';
+	}
+	write_avparser_str( wr, ptr, (digits + sizeof(digits)) - ptr );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_fixed
+// Description  : write a value with a fixed number of decimal places (as 
+//                printf's %.Nf does)
+//
+// Inputs       : wr - the writer
+//                val - the value to write
+//                places - the number of decimal places (at most 9)
+// Outputs      : none
+*/
+
+void write_avparser_fixed( avparser_writer *wr, double val, int places ) {
+
+	/* Local variables */
+	char digits[32], *ptr = digits + sizeof(digits);
+	unsigned long long scale = 1, scaled;
+	double mag = (val < 0) ? -val : val, rem;
+	int i;
+
+	/* Values out of range (or not numbers) are left to the C library */
+	for ( i = 0; i < places; i ++ ) {
+		scale *= 10;
+	}
+	if ( (places < 0) || (places > 9) || !(mag < 1e9) ) {
+		i = snprintf( digits, sizeof(digits), "%.*f", places, val );
+		write_avparser_str( wr, digits, ((size_t)i < sizeof(digits)) ? (size_t)i : sizeof(digits) - 1 );
+		return;
+	}
+
+	/* Scale and round the value, fill in the digits (values within 1e-6 of
+	   a half are left to the C library, the scaling may have rounded them, 
+	   at about 200ns a call, the altimeters, in hundredths, never are) */
+	scaled = (unsigned long long)(mag * scale);
+	rem = (mag * scale) - (double)scaled;
+	if ( (rem > 0.5 - 1e-6) && (rem < 0.5 + 1e-6) ) {
+		i = snprintf( digits, sizeof(digits), "%.*f", places, val );
+		write_avparser_str( wr, digits, ((size_t)i < sizeof(digits)) ? (size_t)i : sizeof(digits) - 1 );
+		return;
+	}
+	if ( rem > 0.5 ) {
+		scaled ++;
+	}
+	for ( i = 0; i < places; i ++ ) {
+		*--ptr = (char)('0' + (scaled % 10));
+		scaled /= 10;
+	}
+	if ( places > 0 ) {
+		*--ptr = '.';
+	}
+	do {
+		*--ptr = (char)('0' + (scaled % 10));
+		scaled /= 10;
+	} while ( scaled != 0 );
+	if ( val < 0 ) {
+		*--ptr = '-';
+	}
+	write_avparser_str( wr, ptr, (digits + sizeof(digits)) - ptr );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : format_avparser_time
+// Description  : format a time as "hh:mm:ss AM on Day, Month dd yyyy" (the
+//                strftime "%r on %A, %B %d %Y" of the C locale, local time)
+//
+// Inputs       : str - the string to format into (at least 64 bytes)
+//                t - the time to format
+// Outputs      : the length of the formatted time
+*/
+
+static size_t format_avparser_time( char *str, time_t t ) {
+
+	/* Local variables */
+	struct tm tm_buf;
+	char *ptr = str, year[16], *yptr = year + sizeof(year);
+	int hour;
+	long yval;
+
+	/* Convert to local time (nothing if the time cannot be converted) */
+	if ( localtime_r(&t, &tm_buf) == NULL ) {
+		return( 0 );
+	}
+
+	/* Time of day, 12 hour clock */
+	hour = (tm_buf.tm_hour % 12 == 0) ? 12 : tm_buf.tm_hour % 12;
+	*ptr++ = (char)('0' + hour / 10);
+	*ptr++ = (char)('0' + hour % 10);
+	*ptr++ = ':';
+	*ptr++ = (char)('0' + tm_buf.tm_min / 10);
+	*ptr++ = (char)('0' + tm_buf.tm_min % 10);
+	*ptr++ = ':';
+	*ptr++ = (char)('0' + tm_buf.tm_sec / 10);
+	*ptr++ = (char)('0' + tm_buf.tm_sec % 10);
+	memcpy( ptr, (tm_buf.tm_hour < 12) ? " AM on " : " PM on ", 7 );
+	ptr += 7;
+
+	/* Day, month, day of the month and year */
+	strcpy( ptr, avw_day_names[tm_buf.tm_wday] );
+	ptr += strlen( ptr );
+	*ptr++ = ',';
+	*ptr++ = ' ';
+	strcpy( ptr, avw_month_names[tm_buf.tm_mon] );
+	ptr += strlen( ptr );
+	*ptr++ = ' ';
+	*ptr++ = (char)('0' + tm_buf.tm_mday / 10);
+	*ptr++ = (char)('0' + tm_buf.tm_mday % 10);
+	*ptr++ = ' ';
+	yval = (long)tm_buf.tm_year + 1900;
+	do {
+		*--yptr = (char)('0' + ((yval < 0) ? -(yval % 10) : (yval % 10)));
+		yval /= 10;
+	} while ( yval != 0 );
+	if ( tm_buf.tm_year + 1900 < 0 ) {
+		*--yptr = '-';
+	}
+	memcpy( ptr, yptr, (year + sizeof(year)) - yptr );
+	ptr += (year + sizeof(year)) - yptr;
+	return( ptr - str );
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_time
+// Description  : write a formatted time (the last time formatted in each 
+//                slot is kept, readings often repeat times)
+//
+// Inputs       : wr - the writer
+//                slot - the cache slot to use (0 zulu, 1 local)
+//                t - the time to write
+// Outputs      : none
+*/
+
+static void write_avparser_time( avparser_writer *wr, int slot, time_t t ) {
+
+	/* Format the time if not the one last formatted, write it */
+	if ( (wr->tlen[slot] == 0) || (wr->tcache[slot] != t) ) {
+		wr->tlen[slot] = format_avparser_time( wr->tstr[slot], t );
+		wr->tcache[slot] = t;
+	}
+	write_avparser_str( wr, wr->tstr[slot], wr->tlen[slot] );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avreading_condition
+// Description  : write a single condition reading (as text, see
+//                avreading_condition_to_string)
+//
+// Inputs       : wr - the writer
+//                cond - the condition to write
+// Outputs      : none
+*/
+
+void write_avreading_condition( avparser_writer *wr, avreading_condition *cond ) {
+
+	/* Local variables */
+	char tempstr[128];
+	int condidx;
+
+	/* Write the intensity of the condition, if there is one */
+	if ( cond->intensity == AVR_CONDITION_ITENSITY_LIGHT ) {
+		write_avparser_str( wr, "Light ", 6 );
+	} else if ( cond->intensity == AVR_CONDITION_ITENSITY_HEAVY ) {
+		write_avparser_str( wr, "Heavy ", 6 );
+	} else if ( cond->intensity != AVR_CONDITION_ITENSITY_NONE ) {
+		/* Unknown intensity level, error out */
+		snprintf(tempstr, 128, "Bad intensity value in parsed aviation data [%d]", cond->intensity);
+		AVPARSE_FATAL_ERROR(tempstr);
+		exit(-1);			
+	}
+
+	/* Now add the conditions */
+	for ( condidx = 0; (condidx < AVR_MAX_CONDS) && (cond->conditions[condidx] != AVR_CONDITION_UN); condidx ++ ) {
+		if ( cond->conditions[condidx] >= AVR_CONDITION_MAX ) {
+			/* Unknown condition, error out */
+			snprintf(tempstr, 128, "Bad condition value in parsed aviation data [%d]", cond->conditions[condidx]);
+			AVPARSE_FATAL_ERROR(tempstr);
+			exit(-1);					
+		}
+		if ( condidx > 0 ) {
+			write_avparser_str( wr, ", ", 2 );
+		}
+		write_avparser_cstr( wr, avr_condition_strings[cond->conditions[condidx]][0] );
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avreading
+// Description  : write a reading (as text, see avreading_to_string)
+//
+// Inputs       : wr - the writer
+//                avr - the reading to write
+//                ind - indentation for fields
+// Outputs      : none
+*/
+
+void write_avreading( avparser_writer *wr, avreading *avr, int ind ) {
+
+	/* Local variables */
+	avreading_condition *condptr;
+	avreading_coverage *coverage;
+
+	/* Add the field/time context */
+	write_avparser_str( wr, "READING:\n", 9 );
+	write_avparser_chars( wr, ' ', ind );
+	write_avparser_str( wr, "Field: ", 7 );
+	write_avparser_cstr( wr, avr->field );
+	write_avparser_chars( wr, '\n', 1 );
+	write_avparser_chars( wr, ' ', ind );
+	write_avparser_str( wr, "Zulu time: ", 11 );
+	write_avparser_time( wr, 0, avr->rtime.zulu );
+	write_avparser_chars( wr, '\n', 1 );
+	write_avparser_chars( wr, ' ', ind );
+	write_avparser_str( wr, "Local time: ", 12 );
+	write_avparser_time( wr, 1, avr->rtime.local );
+	write_avparser_chars( wr, '\n', 1 );
+
+	/* Wind, visibility (the fields not decoded are left out) */
+	if ( ! AVW_MISSING(avr, AVR_FIELD_WIND) ) {
+		write_avparser_chars( wr, ' ', ind );
+		write_avparser_str( wr, "Wind ", 5 );
+		write_avparser_int( wr, avr->rwind.speed );
+		write_avparser_str( wr, " knots at ", 10 );
+		write_avparser_int( wr, avr->rwind.direction );
+		if ( avr->rwind.gust != -1 ) {
+			write_avparser_str( wr, ", gusting ", 10 );
+			write_avparser_int( wr, avr->rwind.gust );
+			write_avparser_str( wr, " knots", 6 );
+		}
+		write_avparser_chars( wr, '\n', 1 );
+	}
+	if ( ! AVW_MISSING(avr, AVR_FIELD_VISIBILITY) ) {
+		write_avparser_chars( wr, ' ', ind );
+		write_avparser_str( wr, "Visibility: ", 12 );
+		write_avparser_int( wr, avr->rviz );
+		write_avparser_str( wr, " statue miles\n", 14 );
+	}
+
+	/* The weather conditions (on one line) */
+	for ( condptr = avr->rcond; condptr != NULL; condptr = condptr->next ) {
+		if ( condptr == avr->rcond ) {	
+			write_avparser_chars( wr, ' ', ind );
+		} else {
+			write_avparser_str( wr, "; ", 2 );
+		}
+		write_avreading_condition( wr, condptr );
+		if ( condptr->next == NULL ) {
+			write_avparser_chars( wr, '\n', 1 );
+		}
+	}
+
+	/* The cloud layers */
+	for ( coverage = avr->rcvrg; coverage != NULL; coverage = coverage->next ) {
+		write_avparser_chars( wr, ' ', ind );
+		write_avparser_str( wr, "Cloud layer ", 12 );
+		if ( (coverage->coverage < AVR_SKYCLEAR) || (coverage->coverage > AVR_OVERCAST) ) {
+			write_avparser_cstr( wr, avr_coverage_strings[AVR_UNKNOWN] );
+		} else {
+			write_avparser_cstr( wr, avr_coverage_strings[coverage->coverage] );
+		}
+		if ( coverage->coverage != AVR_SKYCLEAR ) {
+			write_avparser_str( wr, " at ", 4 );
+			write_avparser_int( wr, (int)coverage->altitude );
+			write_avparser_str( wr, " feet", 5 );
+		}
+		write_avparser_chars( wr, '\n', 1 );
+	}
+
+	/* Temperature, dewpoint and altimeter */
+	if ( ! AVW_MISSING(avr, AVR_FIELD_TEMPERATURE) ) {
+		write_avparser_chars( wr, ' ', ind );
+		write_avparser_str( wr, "Temperature: ", 13 );
+		write_avparser_int( wr, avr->rtemp.temperature_celsisus );
+		write_avparser_str( wr, " Celsisus, ", 11 );
+		write_avparser_int( wr, avr->rtemp.temperature_fahrenheit );
+		write_avparser_str( wr, " Fahrenheit\n", 12 );
+		write_avparser_chars( wr, ' ', ind );
+		write_avparser_str( wr, "Dew point: ", 11 );
+		write_avparser_int( wr, avr->rtemp.dewpoint_celsisus );
+		write_avparser_str( wr, " Celsisus, ", 11 );
+		write_avparser_int( wr, avr->rtemp.dewpoint_fahrenheit );
+		write_avparser_str( wr, ", Fahrenheit\n", 13 );
+	}
+	if ( ! AVW_MISSING(avr, AVR_FIELD_ALTIMETER) ) {
+		write_avparser_chars( wr, ' ', ind );
+		write_avparser_str( wr, "Altimeter setting: ", 19 );
+		write_avparser_fixed( wr, avr->raltm, 2 );
+		write_avparser_str( wr, " inches\n", 8 );
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_json_str
+// Description  : write a JSON string (quoted, escaped)
+//
+// Inputs       : wr - the writer
+//                str - the (terminated) string to write
+// Outputs      : none
+*/
+
+static void write_avparser_json_str( avparser_writer *wr, const char *str ) {
+
+	/* Local variables */
+	static const char hex[] = "0123456789abcdef";
+	const char *run = str;
+	char esc[6] = { '\\', 'u', '0', '0', 0, 0 };
+
+	/* Write runs of plain characters, escape the others */
+	write_avparser_chars( wr, '"', 1 );
+	for ( ; *str != 0x0; str ++ ) {
+		if ( ((unsigned char)*str < 0x20) || (*str == '"') || (*str == '\\') ) {
+			write_avparser_str( wr, run, str - run );
+			if ( (unsigned char)*str < 0x20 ) {
+				esc[4] = hex[(unsigned char)*str >> 4];
+				esc[5] = hex[(unsigned char)*str & 0xf];
+				write_avparser_str( wr, esc, 6 );
+			} else {
+				write_avparser_chars( wr, '\\', 1 );
+				write_avparser_chars( wr, *str, 1 );
+			}
+			run = str + 1;
+		}
+	}
+	write_avparser_str( wr, run, str - run );
+	write_avparser_chars( wr, '"', 1 );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_codes
+// Description  : write the two letter codes of a condition group
+//
+// Inputs       : wr - the writer
+//                cond - the condition group
+//                sep - the text between the codes
+//                quote - flag indicating the codes should be quoted
+// Outputs      : none
+*/
+
+static void write_avparser_codes( avparser_writer *wr, avreading_condition *cond, const char *sep, int quote ) {
+
+	/* Local variables */
+	int condidx;
+
+	/* Walk the conditions of the group */
+	for ( condidx = 0; (condidx < AVR_MAX_CONDS) && (cond->conditions[condidx] != AVR_CONDITION_UN); condidx ++ ) {
+		if ( condidx > 0 ) {
+			write_avparser_cstr( wr, sep );
+		}
+		if ( quote ) {
+			write_avparser_chars( wr, '"', 1 );
+		}
+		write_avparser_str( wr, (cond->conditions[condidx] < AVR_CONDITION_MAX) ? 
+							avr_condition_strings[cond->conditions[condidx]][1] : "??", 2 );
+		if ( quote ) {
+			write_avparser_chars( wr, '"', 1 );
+		}
+	}
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avreading_jsonl
+// Description  : write a reading as a JSON object (on one line)
+//
+// Inputs       : wr - the writer
+//                avr - the reading to write
+// Outputs      : none
+*/
+
+void write_avreading_jsonl( avparser_writer *wr, avreading *avr ) {
+
+	/* Local variables */
+	avreading_condition *cond;
+	avreading_coverage *cvg;
+
+	/* Station, times and correction */
+	write_avparser_str( wr, "{\"station\":", 11 );
+	write_avparser_json_str( wr, avr->field );
+	write_avparser_str( wr, ",\"zulu\":", 8 );
+	write_avparser_int( wr, (long)avr->rtime.zulu );
+	write_avparser_str( wr, ",\"local\":", 9 );
+	write_avparser_int( wr, (long)avr->rtime.local );
+	write_avparser_cstr( wr, (avr->rcorr) ? ",\"corrected\":true" : ",\"corrected\":false" );
+
+	/* Wind and visibility */
+	if ( AVW_MISSING(avr, AVR_FIELD_WIND) ) {
+		write_avparser_cstr( wr, ",\"wind\":null" );
+	} else {
+		write_avparser_str( wr, ",\"wind\":{\"direction\":", 21 );
+		write_avparser_int( wr, avr->rwind.direction );
+		write_avparser_str( wr, ",\"speed\":", 9 );
+		write_avparser_int( wr, avr->rwind.speed );
+		write_avparser_str( wr, ",\"gust\":", 8 );
+		if ( avr->rwind.gust == -1 ) {
+			write_avparser_str( wr, "null", 4 );
+		} else {
+			write_avparser_int( wr, avr->rwind.gust );
+		}
+		write_avparser_chars( wr, '}', 1 );
+	}
+	write_avparser_str( wr, ",\"visibility\":", 14 );
+	if ( AVW_MISSING(avr, AVR_FIELD_VISIBILITY) ) {
+		write_avparser_str( wr, "null", 4 );
+	} else {
+		write_avparser_int( wr, avr->rviz );
+	}
+
+	/* Condition groups and cloud layers */
+	if ( AVW_MISSING(avr, AVR_FIELD_CONDITIONS) ) {
+		write_avparser_cstr( wr, ",\"conditions\":null" );
+	} else {
+		write_avparser_str( wr, ",\"conditions\":[", 15 );
+		for ( cond = avr->rcond; cond != NULL; cond = cond->next ) {
+			write_avparser_str( wr, "{\"intensity\":\"", 14 );
+			write_avparser_cstr( wr, AVW_CONDITION_OK(cond) ? avw_intensity_names[cond->intensity] : "unknown" );
+			write_avparser_str( wr, "\",\"codes\":[", 11 );
+			write_avparser_codes( wr, cond, ",", 1 );
+			write_avparser_cstr( wr, (cond->next != NULL) ? "]}," : "]}" );
+		}
+		write_avparser_chars( wr, ']', 1 );
+	}
+	if ( AVW_MISSING(avr, AVR_FIELD_COVERAGE) ) {
+		write_avparser_cstr( wr, ",\"layers\":null" );
+	} else {
+		write_avparser_str( wr, ",\"layers\":[", 11 );
+		for ( cvg = avr->rcvrg; cvg != NULL; cvg = cvg->next ) {
+			write_avparser_str( wr, "{\"coverage\":\"", 13 );
+			write_avparser_str( wr, AVW_COVERAGE_CODE(cvg), 3 );
+			write_avparser_str( wr, "\",\"altitude\":", 13 );
+			write_avparser_int( wr, cvg->altitude );
+			write_avparser_cstr( wr, (cvg->next != NULL) ? "}," : "}" );
+		}
+		write_avparser_chars( wr, ']', 1 );
+	}
+
+	/* Temperature, dewpoint and altimeter */
+	if ( AVW_MISSING(avr, AVR_FIELD_TEMPERATURE) ) {
+		write_avparser_cstr( wr, ",\"temperature\":null,\"dewpoint\":null,\"temperature_f\":null,\"dewpoint_f\":null" );
+	} else {
+		write_avparser_str( wr, ",\"temperature\":", 15 );
+		write_avparser_int( wr, avr->rtemp.temperature_celsisus );
+		write_avparser_str( wr, ",\"dewpoint\":", 12 );
+		write_avparser_int( wr, avr->rtemp.dewpoint_celsisus );
+		write_avparser_str( wr, ",\"temperature_f\":", 17 );
+		write_avparser_int( wr, avr->rtemp.temperature_fahrenheit );
+		write_avparser_str( wr, ",\"dewpoint_f\":", 14 );
+		write_avparser_int( wr, avr->rtemp.dewpoint_fahrenheit );
+	}
+	write_avparser_str( wr, ",\"altimeter\":", 13 );
+	if ( AVW_MISSING(avr, AVR_FIELD_ALTIMETER) ) {
+		write_avparser_str( wr, "null", 4 );
+	} else {
+		write_avparser_fixed( wr, avr->raltm, 2 );
+	}
+	write_avparser_str( wr, "}\n", 2 );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avreading_csv
+// Description  : write a reading as a line of comma separated values (the 
+//                conditions as METAR groups, the layers as coverage:feet, 
+//                both space separated)
+//
+// Inputs       : wr - the writer
+//                avr - the reading to write
+// Outputs      : none
+*/
+
+void write_avreading_csv( avparser_writer *wr, avreading *avr ) {
+
+	/* Local variables */
+	avreading_condition *cond;
+	avreading_coverage *cvg;
+
+	/* Station, times, correction, wind and visibility (the fields not 
+	   decoded are empty) */
+	write_avparser_cstr( wr, avr->field );
+	write_avparser_chars( wr, ',', 1 );
+	write_avparser_int( wr, (long)avr->rtime.zulu );
+	write_avparser_chars( wr, ',', 1 );
+	write_avparser_int( wr, (long)avr->rtime.local );
+	write_avparser_str( wr, (avr->rcorr) ? ",1," : ",0,", 3 );
+	if ( ! AVW_MISSING(avr, AVR_FIELD_WIND) ) {
+		write_avparser_int( wr, avr->rwind.direction );
+		write_avparser_chars( wr, ',', 1 );
+		write_avparser_int( wr, avr->rwind.speed );
+	} else {
+		write_avparser_chars( wr, ',', 1 );
+	}
+	write_avparser_chars( wr, ',', 1 );
+	if ( avr->rwind.gust != -1 ) {
+		write_avparser_int( wr, avr->rwind.gust );
+	}
+	write_avparser_chars( wr, ',', 1 );
+	if ( ! AVW_MISSING(avr, AVR_FIELD_VISIBILITY) ) {
+		write_avparser_int( wr, avr->rviz );
+	}
+	write_avparser_chars( wr, ',', 1 );
+
+	/* Condition groups (-RABR), cloud layers (BKN:3900) */
+	for ( cond = avr->rcond; cond != NULL; cond = cond->next ) {
+		if ( cond->intensity == AVR_CONDITION_ITENSITY_LIGHT ) {
+			write_avparser_chars( wr, '-', 1 );
+		} else if ( cond->intensity == AVR_CONDITION_ITENSITY_HEAVY ) {
+			write_avparser_chars( wr, '+', 1 );
+		}
+		write_avparser_codes( wr, cond, "", 0 );
+		if ( cond->next != NULL ) {
+			write_avparser_chars( wr, ' ', 1 );
+		}
+	}
+	write_avparser_chars( wr, ',', 1 );
+	for ( cvg = avr->rcvrg; cvg != NULL; cvg = cvg->next ) {
+		write_avparser_str( wr, AVW_COVERAGE_CODE(cvg), 3 );
+		write_avparser_chars( wr, ':', 1 );
+		write_avparser_int( wr, cvg->altitude );
+		if ( cvg->next != NULL ) {
+			write_avparser_chars( wr, ' ', 1 );
+		}
+	}
+
+	/* Temperature, dewpoint and altimeter */
+	if ( ! AVW_MISSING(avr, AVR_FIELD_TEMPERATURE) ) {
+		write_avparser_chars( wr, ',', 1 );
+		write_avparser_int( wr, avr->rtemp.temperature_celsisus );
+		write_avparser_chars( wr, ',', 1 );
+		write_avparser_int( wr, avr->rtemp.dewpoint_celsisus );
+		write_avparser_chars( wr, ',', 1 );
+		write_avparser_int( wr, avr->rtemp.temperature_fahrenheit );
+		write_avparser_chars( wr, ',', 1 );
+		write_avparser_int( wr, avr->rtemp.dewpoint_fahrenheit );
+	} else {
+		write_avparser_str( wr, ",,,,", 4 );
+	}
+	write_avparser_chars( wr, ',', 1 );
+	if ( ! AVW_MISSING(avr, AVR_FIELD_ALTIMETER) ) {
+		write_avparser_fixed( wr, avr->raltm, 2 );
+	}
+	write_avparser_chars( wr, '\n', 1 );
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_avparser_reading
+// Description  : write a reading in the format of the writer (the CSV header
+//                is written before the first reading)
+//
+// Inputs       : wr - the writer
+//                avr - the reading to write
+// Outputs      : none
+*/
+
+void write_avparser_reading( avparser_writer *wr, avreading *avr ) {
+
+#ifdef AVPARSE_STATS
+	/* Local variables */
+	int timing = (wr->stats != NULL) && ((wr->stats->written ++ & (wr->stats->sample-1)) == 0);
+	uint64_t start = (timing) ? read_avparser_cycles() : 0;
+#endif
+
+	/* Write in the selected format */
+	switch ( wr->format ) {
+
+	case AVP_FORMAT_JSONL:
+		write_avreading_jsonl( wr, avr );
+		break;
+
+	case AVP_FORMAT_CSV:
+		if ( ! wr->header ) {
+			write_avparser_str( wr, AVW_CSV_HEADER, sizeof(AVW_CSV_HEADER) - 1 );
+			wr->header = 1;
+		}
+		write_avreading_csv( wr, avr );
+		break;
+
+	default:
+		write_avreading( wr, avr, 2 );
+		break;
+	}
+#ifdef AVPARSE_STATS
+	if ( timing ) {
+		wr->stats->cycles[AVS_TIMER_OUTPUT] += read_avparser_cycles() - start;
+		wr->stats->timed[AVS_TIMER_OUTPUT] ++;
+	}
+#endif
+	return;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+//
+// Function     : write_parsed_input
+// Description  : write the readings of the parser output (in the format of 
+//                the writer)
+//
+// Inputs       : wr - the writer
+//                avp - pointer to the avparser output
+// Outputs      : none
+*/
+
+void write_parsed_input( avparser_writer *wr, avparser_out *avp ) {
+
+	/* Local variables */
+	avreading *ptr;
+
+	/* Walk the readings, write each out */
+	for ( ptr = avp->readings; ptr != NULL; ptr = ptr->next ) {
+		write_avparser_reading( wr, ptr );
+	}
+	return;
+}
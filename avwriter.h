@@ -0,0 +1,66 @@
+#ifndef AVWRITER_INCLUDED
+/*//////////////////////////////////////////////////////////////////////////////
+//
+//  File          : avwriter.h
+//  Description   : This file contains the definitions for the buffered text
+//                  output writer of the avparse library.
+//
+//   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+//   Created      : Fri Dec 13 09:12:05 EST 2019
+*/
+
+/** Include Files **/
+#include <stdio.h>
+#include <time.h>
+#include <avparse.h>
+
+/** Definitions and Types **/
+#define AVPARSE_WRITER_BLOCK (64*1024) /* Size of the blocks flushed */
+#define AVPARSE_WRITER_MEMORY 256     /* Initial size of a memory writer (grown) */
+
+/* Formats readings are written in */
+typedef enum avparser_format_enum {
+	AVP_FORMAT_TEXT  = 0, /* Human readable text (avreading_to_string) */
+	AVP_FORMAT_JSONL = 1, /* JSON lines, one object per reading */
+	AVP_FORMAT_CSV   = 2, /* Comma separated values, with a header line */
+} avparser_format;
+
+/* Buffered writer, output is gathered and flushed in large blocks to a file
+   or descriptor (or kept in memory if there is neither, or written into a
+   fixed buffer of the caller) */
+typedef struct avparser_writer_struct {
+	char   *buf;    /* The output buffer */
+	size_t  len;    /* The number of bytes in the buffer */
+	size_t  size;   /* The allocated size of the buffer */
+	FILE   *file;   /* The file flushed to (NULL if none) */
+	int     fd;     /* The descriptor flushed to (-1 if none) */
+	int     error;  /* Flag indicating a flush failed */
+	int     fixed;  /* Flag indicating buf is the caller's (output past it is dropped) */
+	avparser_format format; /* The format readings are written in */
+	int     header; /* Flag indicating the (CSV) header was written */
+	time_t  tcache[2];     /* The times last formatted (zulu, local) */
+	char    tstr[2][64];   /* The formatted times */
+	size_t  tlen[2];       /* The lengths of the formatted times */
+	struct avparser_stats_struct *stats; /* The statistics output is timed in (NULL if none) */
+} avparser_writer;
+
+/** Functional Prototypes **/
+avparser_writer *     allocate_avparser_writer( FILE *file, int fd );
+void                  fixed_avparser_writer( avparser_writer *wr, char *buf, size_t size );
+int                   flush_avparser_writer( avparser_writer *wr );
+int                   release_avparser_writer( avparser_writer *wr );
+char *                detach_avparser_writer( avparser_writer *wr );
+void                  write_avparser_str( avparser_writer *wr, const char *str, size_t len );
+void                  write_avparser_cstr( avparser_writer *wr, const char *str );
+void                  write_avparser_chars( avparser_writer *wr, char ch, size_t count );
+void                  write_avparser_int( avparser_writer *wr, long val );
+void                  write_avparser_fixed( avparser_writer *wr, double val, int places );
+void                  write_avreading_condition( avparser_writer *wr, avreading_condition *cond );
+void                  write_avreading( avparser_writer *wr, avreading *avr, int ind );
+void                  write_avreading_jsonl( avparser_writer *wr, avreading *avr );
+void                  write_avreading_csv( avparser_writer *wr, avreading *avr );
+void                  write_avparser_reading( avparser_writer *wr, avreading *avr );
+void                  write_parsed_input( avparser_writer *wr, avparser_out *avp );
+
+#define AVWRITER_INCLUDED
+#endif
@@ -0,0 +1,94 @@
+#!/bin/sh
+#
+#  File          : follow-check.sh
+#  Description   : Check the follow mode of avparse (-F), a generated feed is
+#                  appended to (splitting a line), truncated and regrown past
+#                  the offset read, rotated and deleted while it is followed,
+#                  the readings printed must be those of a parse of the lines
+#                  written (in order), and the deletion must stop it.
+#
+#  Usage         : follow-check.sh [<avparse>]
+#
+#   Author       : Patrick McDaniel (pdmcdan@gmail.com)
+#   Created      : Mon Dec 23 15:02:11 EST 2019
+#
+
+AVPARSE=${1:-./avparse}
+DIR=`mktemp -d ${TMPDIR:-/tmp}/avfollow.XXXXXX` || exit 1
+PID=
+trap 'test -n "$PID" && kill $PID 2>/dev/null; rm -rf $DIR' 0
+trap 'exit 1' 1 2 15
+
+# Fail the check
+fail() {
+	echo "follow-check: $1" >&2
+	test -f $DIR/err && cat $DIR/err >&2
+	exit 1
+}
+
+# Wait for the readings of the lines written so far to be printed
+expect() {
+	want=`$AVPARSE -f $DIR/expect -o csv | wc -l`
+	for i in `seq 100`; do
+		test `wc -l < $DIR/out` -ge $want && return
+		sleep 0.1
+	done
+	fail "$1: expected $want lines, printed `wc -l < $DIR/out`"
+}
+
+# Stop the follower while the file is changed, then let it see the change
+frozen() {
+	kill -STOP $PID
+	"$@"
+	kill -CONT $PID
+}
+
+# The corpus, split into the parts written
+$AVPARSE -g 4000 > $DIR/corpus || fail "unable to generate the corpus"
+sed -n '1,1000p' $DIR/corpus > $DIR/part1
+sed -n '1001,2000p' $DIR/corpus > $DIR/part2
+sed -n '1001,3500p' $DIR/corpus > $DIR/part3
+sed -n '3501,3700p' $DIR/corpus > $DIR/part4
+sed -n '3701,4000p' $DIR/corpus > $DIR/part5
+half=$((`wc -c < $DIR/part2` / 2))
+
+# Follow the feed from the start
+cp $DIR/part1 $DIR/feed
+cp $DIR/part1 $DIR/expect
+$AVPARSE -F $DIR/feed -o csv > $DIR/out 2> $DIR/err &
+PID=$!
+expect "start"
+
+# Append, the first write ending part way through a line
+head -c $half $DIR/part2 >> $DIR/feed
+sleep 0.5
+tail -c +$((half + 1)) $DIR/part2 >> $DIR/feed
+cat $DIR/part2 >> $DIR/expect
+expect "append"
+
+# Truncate, and grow the file past the offset read before it is read
+frozen sh -c "cat $DIR/part3 > $DIR/feed"
+cat $DIR/part3 >> $DIR/expect
+expect "truncate"
+
+# Rotate, the old file is appended to before the new one is created
+frozen sh -c "cat $DIR/part4 >> $DIR/feed; mv $DIR/feed $DIR/feed.1; cat $DIR/part5 > $DIR/feed"
+cat $DIR/part4 $DIR/part5 >> $DIR/expect
+expect "rotate"
+
+# Delete, the follower reports it and stops
+rm $DIR/feed
+for i in `seq 100`; do
+	kill -0 $PID 2>/dev/null || break
+	sleep 0.1
+done
+kill -0 $PID 2>/dev/null && fail "delete: still following the deleted file"
+wait $PID || fail "delete: exited with an error"
+PID=
+grep -q "deleted" $DIR/err || fail "delete: the deletion was not reported"
+
+# The readings printed are those of the lines written
+$AVPARSE -f $DIR/expect -o csv > $DIR/want
+cmp -s $DIR/want $DIR/out || fail "the readings printed differ from a parse of the lines written"
+echo "Followed `wc -l < $DIR/expect` lines (appended, truncated, rotated, deleted), 0 differences."
+exit 0